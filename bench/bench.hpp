@@ -0,0 +1,43 @@
+#ifndef KATERM_BENCH_HPP
+#define KATERM_BENCH_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace katerm::bench {
+
+// Runs the workload once and returns the number of bytes it processed.
+using bench_function = std::size_t(*)();
+
+struct benchmark {
+    char const* name;
+    bench_function run;
+};
+
+std::vector<benchmark>& registry();
+
+struct registration {
+    registration(benchmark b)
+    {
+        registry().push_back(b);
+    }
+};
+
+// Adds a latency sample to the running benchmark. Percentiles are printed
+// after the throughput when a benchmark records any.
+void record_latency(double nanoseconds);
+
+// Keeps the optimizer from throwing away work whose result isn't used.
+void do_not_optimize(void const* value);
+
+} // katerm::bench::
+
+#define KATERM_BENCH_CONCAT_IMPL(a, b) a##b
+#define KATERM_BENCH_CONCAT(a, b) KATERM_BENCH_CONCAT_IMPL(a, b)
+
+#define KATERM_BENCHMARK(name, function)                     \
+    static ::katerm::bench::registration                     \
+        KATERM_BENCH_CONCAT(bench_registration_, __LINE__){  \
+            {name, function}}
+
+#endif // header guard
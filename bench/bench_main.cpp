@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "bench.hpp"
+
+namespace katerm::bench {
+
+std::vector<benchmark>& registry()
+{
+    static std::vector<benchmark> benchmarks;
+    return benchmarks;
+}
+
+namespace {
+
+std::vector<double>& latencies()
+{
+    static std::vector<double> samples;
+    return samples;
+}
+
+} // anonymous namespace
+
+void record_latency(double const nanoseconds)
+{
+    latencies().push_back(nanoseconds);
+}
+
+void do_not_optimize(void const* value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    // Tells the compiler value and everything it points to are read.
+    asm volatile("" : : "g"(value) : "memory");
+#else
+    static void const* volatile sink;
+    sink = value;
+    static_cast<void>(sink);
+#endif
+}
+
+} // katerm::bench::
+
+namespace {
+
+constexpr auto min_duration = std::chrono::milliseconds{500};
+constexpr int min_iterations = 3;
+
+void run(katerm::bench::benchmark const& b, bool const csv)
+{
+    using clock = std::chrono::steady_clock;
+
+    // Warm up caches and allocations
+    b.run();
+    katerm::bench::latencies().clear();
+
+    auto iterations = 0;
+    auto bytes = std::size_t{0};
+    auto const start = clock::now();
+    auto elapsed = clock::duration{};
+
+    while (iterations < min_iterations || elapsed < min_duration) {
+        bytes += b.run();
+        ++iterations;
+        elapsed = clock::now() - start;
+    }
+
+    auto const seconds = std::chrono::duration<double>(elapsed).count();
+    auto const ns_per_byte = seconds * 1e9 / static_cast<double>(bytes);
+    auto const mb_per_second = static_cast<double>(bytes) / seconds / 1e6;
+
+    auto& samples = katerm::bench::latencies();
+    std::sort(samples.begin(), samples.end());
+    auto const percentile = [&](double const p) {
+        if (samples.empty())
+            return 0.0;
+
+        return samples[static_cast<std::size_t>(p * (samples.size() - 1))] / 1e3;
+    };
+
+    if (csv) {
+        std::printf("%s,%d,%.2f,%.3f,%.2f,%.2f\n",
+                    b.name, iterations, mb_per_second, ns_per_byte,
+                    percentile(0.5), percentile(0.99));
+        return;
+    }
+
+    std::printf("%-40s %8d iterations %10.2f MB/s %10.3f ns/byte\n",
+                b.name, iterations, mb_per_second, ns_per_byte);
+
+    if (!samples.empty()) {
+        std::printf("%-40s %8zu samples   p50 %8.2f us  p99 %8.2f us  max %8.2f us\n",
+                    "", samples.size(), percentile(0.5), percentile(0.99), percentile(1.0));
+    }
+}
+
+} // anonymous namespace
+
+// Usage: katerm_bench [--csv] [filter]
+// Only benchmarks whose name contains filter are run.
+//
+// --csv prints one line per benchmark for scripts comparing runs:
+//   name,iterations,MB/s,ns/byte,p50 latency us,p99 latency us
+// Latencies are 0 for benchmarks that don't record any.
+int main(int argc, char** argv)
+{
+    auto csv = false;
+    auto filter = "";
+    for (int i = 1; i != argc; ++i) {
+        if (std::strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else
+            filter = argv[i];
+    }
+
+    if (csv)
+        std::printf("name,iterations,mb_per_s,ns_per_byte,p50_us,p99_us\n");
+
+    for (auto const& b : katerm::bench::registry()) {
+        if (std::strstr(b.name, filter))
+            run(b, csv);
+    }
+}
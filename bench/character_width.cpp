@@ -0,0 +1,99 @@
+#include <string>
+#include <vector>
+
+#include <cw/character_width.hpp>
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+// Mostly CJK with some emoji, Latin-1 and combining marks in between.
+// Bytes are counted as UTF-32.
+std::vector<char32_t> const& wide_text()
+{
+    static auto const text = [] {
+        auto out = std::vector<char32_t>{};
+        auto const sample = std::u32string{
+            U"日本語のテキストと中文字符和한국어 텍스트 😀🎉👍 café naïve é"};
+
+        for (int i = 0; i != 20'000; ++i)
+            out.insert(out.end(), sample.begin(), sample.end());
+
+        return out;
+    }();
+
+    return text;
+}
+
+template<int(*Width)(char32_t)>
+std::size_t total_width()
+{
+    auto const& text = wide_text();
+
+    auto total = 0;
+    for (auto const code : text)
+        total += Width(code);
+
+    katerm::bench::do_not_optimize(&total);
+    return text.size() * sizeof(char32_t);
+}
+
+// UTF-8 text written to the terminal, bytes are the encoded text.
+std::string repeat_lines(char const* const line)
+{
+    auto out = std::string{};
+    for (int i = 0; i != 5'000; ++i) {
+        out += line;
+        out += "\r\n";
+    }
+
+    return out;
+}
+
+template<std::string const&(*Text)()>
+std::size_t write_text()
+{
+    auto const& text = Text();
+
+    katerm::terminal_decoder decoder;
+    katerm::terminal term{{120, 40}};
+    katerm::terminal_instructee instructee{&term};
+    decoder.decode(text.data(), static_cast<int>(text.size()), instructee);
+
+    katerm::bench::do_not_optimize(&term);
+    return text.size();
+}
+
+std::string const& latin_text()
+{
+    static auto const text = repeat_lines(
+        "Größere Änderungen für naïve Cafés à la française, "
+        "Ærøskøbing og Þórshöfn, señor Muñoz y ¿qué más?");
+    return text;
+}
+
+std::string const& cjk_text()
+{
+    static auto const text = repeat_lines(
+        "日本語のテキストを表示する端末エミュレータ、中文字符和标点符号，"
+        "한국어 텍스트도 함께 표시합니다");
+    return text;
+}
+
+std::string const& emoji_text()
+{
+    static auto const text = repeat_lines(
+        "build ✅ tests 🎉🎉 deploy 🚀 warnings ⚠️ 👍🏽 👩‍💻 fixed 🐛 in 3 files 📁");
+    return text;
+}
+
+KATERM_BENCHMARK("write latin-1 text", write_text<latin_text>);
+KATERM_BENCHMARK("write CJK text", write_text<cjk_text>);
+KATERM_BENCHMARK("write emoji text", write_text<emoji_text>);
+
+KATERM_BENCHMARK("character_width inline and table", total_width<cw::character_width>);
+KATERM_BENCHMARK("character_width range search", total_width<cw::character_width_search>);
+
+} // anonymous namespace
@@ -0,0 +1,39 @@
+import argparse
+import csv
+import sys
+
+
+# Compares two `katerm_bench --csv` runs, for use as a regression gate.
+# Exits with 1 when a benchmark in both runs got slower than the threshold.
+
+
+def read_results(file_name):
+    with open(file_name, newline='') as results:
+        return {row['name']: float(row['ns_per_byte']) for row in csv.DictReader(results)}
+
+
+parser = argparse.ArgumentParser(description='Compare benchmark runs')
+parser.add_argument('baseline')
+parser.add_argument('current')
+parser.add_argument('--threshold', type=float, default=10.0,
+                    help='allowed slowdown in percent')
+
+args = parser.parse_args()
+
+baseline = read_results(args.baseline)
+current = read_results(args.current)
+
+regressed = False
+for name, ns_per_byte in current.items():
+    if name not in baseline:
+        continue
+
+    change = (ns_per_byte / baseline[name] - 1) * 100
+    status = 'ok'
+    if change > args.threshold:
+        status = 'REGRESSION'
+        regressed = True
+
+    print(f'{name:40} {baseline[name]:10.3f} -> {ns_per_byte:10.3f} ns/byte {change:+7.1f}% {status}')
+
+sys.exit(1 if regressed else 0)
@@ -0,0 +1,34 @@
+#include <algorithm>
+#include <string>
+
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+// Feeds a control string through the decoder the way a PTY reader would
+// deliver it. This was quadratic when every call re-parsed the string.
+template<std::size_t ChunkSize>
+std::size_t long_osc_in_chunks()
+{
+    static auto const osc = std::string{"\x1b]0;"} + std::string(10 << 20, 'x') + "\a";
+
+    katerm::decoder decoder;
+    katerm::terminal term{{80, 24}};
+    katerm::terminal_instructee instructee{&term};
+
+    for (std::size_t i = 0; i < osc.size(); i += ChunkSize) {
+        auto const n = std::min(ChunkSize, osc.size() - i);
+        decoder.decode(osc.data() + i, static_cast<int>(n), instructee);
+    }
+
+    katerm::bench::do_not_optimize(&term);
+    return osc.size();
+}
+
+KATERM_BENCHMARK("osc 10MiB in 4KiB chunks", long_osc_in_chunks<4096>);
+KATERM_BENCHMARK("osc 10MiB in 64B chunks", long_osc_in_chunks<64>);
+
+} // anonymous namespace
@@ -0,0 +1,139 @@
+import argparse
+import os
+import random
+
+
+# Generates the terminal output corpora replayed by bench/corpus.cpp.
+#
+# The output only depends on the seed, so the checked in files can be
+# regenerated exactly. Every corpus is about CORPUS_SIZE bytes.
+
+CORPUS_SIZE = 256 * 1024
+
+WORDS = [
+    'request', 'handler', 'connection', 'timeout', 'worker', 'cache', 'miss',
+    'hit', 'user', 'session', 'started', 'finished', 'retrying', 'queue',
+    'flush', 'segment', 'index', 'shard', 'replica', 'commit', 'checkpoint',
+]
+
+CJK = (
+    '日本語の文章を端末に表示する時は文字の幅が二列になります。'
+    '中文字符在终端中占用两个字符宽度，标点符号也是如此。'
+    '한국어 문장도 한 글자가 두 칸을 차지합니다.'
+)
+
+
+def ascii_log(rng):
+    """Plain application log lines."""
+    lines = []
+    size = 0
+    second = 0
+    while size < CORPUS_SIZE:
+        second += rng.randint(0, 2)
+        level = rng.choice(['INFO', 'INFO', 'INFO', 'DEBUG', 'WARN', 'ERROR'])
+        message = ' '.join(rng.choice(WORDS) for _ in range(rng.randint(3, 14)))
+        line = (f'2024-03-{1 + second // 86400:02}T{second // 3600 % 24:02}:'
+                f'{second // 60 % 60:02}:{second % 60:02}Z {level:5} '
+                f'[worker-{rng.randint(1, 16)}] {message} id={rng.getrandbits(32):08x}\r\n')
+        lines.append(line)
+        size += len(line)
+
+    return ''.join(lines)
+
+
+def compiler_output(rng):
+    """Coloured diagnostics like gcc and clang print them."""
+    parts = []
+    size = 0
+    while size < CORPUS_SIZE:
+        path = f'src/{rng.choice(WORDS)}/{rng.choice(WORDS)}.cpp'
+        line = rng.randint(1, 2000)
+        column = rng.randint(1, 80)
+        kind, colour = rng.choice([('warning', '35'), ('error', '31'), ('note', '36')])
+        name = rng.choice(WORDS)
+
+        text = (
+            f'\x1b[1m{path}:{line}:{column}: \x1b[0m'
+            f'\x1b[1;{colour}m{kind}: \x1b[0m\x1b[1munused variable '
+            f'‘{name}’ [\x1b[0m\x1b[1;{colour}m-Wunused-variable\x1b[0m\x1b[1m]\x1b[0m\r\n'
+            f' {line:4} |     auto \x1b[1;{colour}m\x1b[K{name}\x1b[m\x1b[K = '
+            f'{rng.choice(WORDS)}(\x1b[38;5;{rng.randint(16, 231)}m{rng.randint(0, 99)}\x1b[39m);\r\n'
+            f'      |          \x1b[1;{colour}m\x1b[K^~~~~~~\x1b[m\x1b[K\r\n'
+        )
+        parts.append(text)
+        size += len(text.encode())
+
+    return ''.join(parts)
+
+
+def tui_redraw(rng):
+    """Full screen redraws addressing every row, like htop or vim."""
+    parts = ['\x1b[?1049h\x1b[?25l']
+    size = 0
+    frame = 0
+    while size < CORPUS_SIZE:
+        text = '\x1b[H'
+        for row in range(1, 49):
+            load = rng.randint(0, 40)
+            text += f'\x1b[{row};1H\x1b[1;36m{row + frame:3}\x1b[0m '
+            text += f'[\x1b[32m{"|" * load}\x1b[31m{" " * (40 - load)}\x1b[39m]'
+            text += f' \x1b[38;2;{rng.randint(0, 255)};{rng.randint(0, 255)};{rng.randint(0, 255)}m'
+            text += f'{load * 2.5:5.1f}%\x1b[m {rng.choice(WORDS):<12}\x1b[K'
+
+        # A status line and the cursor put back, like vim after a redraw.
+        text += f'\x1b[50;1H\x1b[7m -- INSERT -- {frame:6} \x1b[27m\x1b[K\x1b[{rng.randint(1, 48)};{rng.randint(1, 80)}H'
+        parts.append(text)
+        size += len(text.encode())
+        frame += 1
+
+    parts.append('\x1b[?25h\x1b[?1049l')
+    return ''.join(parts)
+
+
+def cjk_text(rng):
+    """Wrapped CJK prose mixed with a little ASCII."""
+    parts = []
+    size = 0
+    while size < CORPUS_SIZE:
+        start = rng.randint(0, len(CJK) - 20)
+        text = f'{rng.randint(1, 9999):4}: {CJK[start:]}{CJK[:start]}\r\n'
+        parts.append(text)
+        size += len(text.encode())
+
+    return ''.join(parts)
+
+
+def long_osc(rng):
+    """Window titles, hyperlinks and one long OSC 52 clipboard write."""
+    parts = []
+    size = 0
+    alphabet = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/'
+    while size < CORPUS_SIZE:
+        title = ' '.join(rng.choice(WORDS) for _ in range(5))
+        text = f'\x1b]0;{title}\x07'
+        text += f'\x1b]8;;https://example.com/{rng.choice(WORDS)}\x1b\\{rng.choice(WORDS)}\x1b]8;;\x1b\\\r\n'
+        text += '\x1b]52;c;' + ''.join(rng.choice(alphabet) for _ in range(16 * 1024)) + '\x07'
+        parts.append(text)
+        size += len(text.encode())
+
+    return ''.join(parts)
+
+
+CORPORA = {
+    'ascii_log': ascii_log,
+    'compiler_output': compiler_output,
+    'tui_redraw': tui_redraw,
+    'cjk_text': cjk_text,
+    'long_osc': long_osc,
+}
+
+parser = argparse.ArgumentParser(description='Generate benchmark corpora')
+parser.add_argument('--output-dir', default=os.path.dirname(os.path.abspath(__file__)))
+parser.add_argument('--seed', type=int, default=1)
+
+args = parser.parse_args()
+
+for name, generate in CORPORA.items():
+    rng = random.Random(f'{args.seed}-{name}')
+    with open(os.path.join(args.output_dir, f'{name}.txt'), 'wb') as output:
+        output.write(generate(rng).encode())
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+// Replays the recorded corpora in bench/corpora the way a PTY reader would
+// deliver them, bytes are the size of the corpus.
+
+std::string load_corpus(char const* const name)
+{
+    auto const path = std::string{KATERM_CORPUS_DIR} + '/' + name + ".txt";
+    auto file = std::ifstream{path, std::ios::binary};
+    if (!file)
+        throw std::runtime_error{"Can't open corpus " + path};
+
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+template<char const* Name>
+std::size_t replay()
+{
+    static auto const corpus = load_corpus(Name);
+    constexpr auto chunk_size = std::size_t{4096};
+
+    katerm::terminal_decoder decoder;
+    katerm::terminal term{{120, 50}};
+    katerm::terminal_instructee instructee{&term};
+
+    for (std::size_t i = 0; i < corpus.size(); i += chunk_size) {
+        auto const n = std::min(chunk_size, corpus.size() - i);
+        decoder.decode(corpus.data() + i, static_cast<int>(n), instructee);
+    }
+
+    katerm::bench::do_not_optimize(&term);
+    return corpus.size();
+}
+
+char const ascii_log[] = "ascii_log";
+char const compiler_output[] = "compiler_output";
+char const tui_redraw[] = "tui_redraw";
+char const cjk_text[] = "cjk_text";
+char const long_osc[] = "long_osc";
+
+KATERM_BENCHMARK("corpus ascii_log", replay<ascii_log>);
+KATERM_BENCHMARK("corpus compiler_output", replay<compiler_output>);
+KATERM_BENCHMARK("corpus tui_redraw", replay<tui_redraw>);
+KATERM_BENCHMARK("corpus cjk_text", replay<cjk_text>);
+KATERM_BENCHMARK("corpus long_osc", replay<long_osc>);
+
+} // anonymous namespace
@@ -0,0 +1,67 @@
+#include <string>
+
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+// Something that looks like htop redrawing: every row is addressed, lots of
+// short coloured segments and few characters between escape sequences.
+std::string const& htop_like_stream()
+{
+    static auto const stream = [] {
+        auto out = std::string{};
+        for (int frame = 0; frame != 50; ++frame) {
+            out += "\x1b[H";
+            for (int row = 1; row <= 48; ++row) {
+                out += "\x1b[" + std::to_string(row) + ";1H";
+                out += "\x1b[1;36m" + std::to_string(row + frame) + "\x1b[0m ";
+
+                auto const load = (row * 7 + frame * 3) % 40;
+                out += "[\x1b[32m" + std::string(load, '|');
+                out += "\x1b[31m" + std::string(40 - load, ' ') + "\x1b[39m]";
+
+                out += " \x1b[38;5;" + std::to_string((row + frame) % 256) + "m";
+                out += std::to_string(load * 2.5) + "%\x1b[m";
+                out += "\x1b[K";
+            }
+        }
+
+        return out;
+    }();
+
+    return stream;
+}
+
+std::size_t virtual_dispatch()
+{
+    auto const& stream = htop_like_stream();
+
+    katerm::decoder decoder;
+    katerm::terminal term{{132, 50}};
+    katerm::terminal_instructee instructee{&term};
+    decoder.decode(stream.data(), static_cast<int>(stream.size()), instructee);
+
+    katerm::bench::do_not_optimize(&term);
+    return stream.size();
+}
+
+std::size_t static_dispatch()
+{
+    auto const& stream = htop_like_stream();
+
+    katerm::terminal_decoder decoder;
+    katerm::terminal term{{132, 50}};
+    katerm::terminal_instructee instructee{&term};
+    decoder.decode(stream.data(), static_cast<int>(stream.size()), instructee);
+
+    katerm::bench::do_not_optimize(&term);
+    return stream.size();
+}
+
+KATERM_BENCHMARK("htop-like virtual dispatch", virtual_dispatch);
+KATERM_BENCHMARK("htop-like static dispatch", static_dispatch);
+
+} // anonymous namespace
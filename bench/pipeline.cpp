@@ -0,0 +1,66 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <katerm/pipeline.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// A prompt line at a time, like output following keystrokes. Latency is from
+// feeding the bytes on the reader thread until the decoder thread published a
+// frame containing them.
+std::size_t pipeline_latency()
+{
+    static auto const line = std::string{"\x1b[32muser@host\x1b[m:~$ ls -l\r\n"};
+    constexpr int rounds = 2000;
+
+    katerm::terminal_pipeline pipeline{{120, 40}};
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> published{0};
+    std::atomic<clock::rep> published_at{0};
+
+    auto decoder = std::thread{[&] {
+        auto total = std::size_t{};
+        while (!done.load(std::memory_order_relaxed)) {
+            if (auto const count = pipeline.process()) {
+                total += count;
+                published_at.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+                published.store(total, std::memory_order_release);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    auto fed = std::size_t{};
+    for (int i = 0; i != rounds; ++i) {
+        auto const start = clock::now().time_since_epoch().count();
+        fed += pipeline.feed(line.data(), line.size());
+
+        while (published.load(std::memory_order_acquire) < fed)
+            std::this_thread::yield();
+
+        auto const end = published_at.load(std::memory_order_relaxed);
+        katerm::bench::record_latency(static_cast<double>(
+            std::chrono::nanoseconds{clock::duration{end - start}}.count()));
+    }
+
+    done.store(true, std::memory_order_relaxed);
+    decoder.join();
+
+    while (pipeline.update()) {
+    }
+
+    katerm::bench::do_not_optimize(&pipeline.current());
+    return fed;
+}
+
+KATERM_BENCHMARK("pipeline byte to frame latency", pipeline_latency);
+
+} // anonymous namespace
@@ -0,0 +1,124 @@
+#include <string>
+#include <vector>
+
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+#include <katerm/scrollback.hpp>
+
+#include "bench.hpp"
+
+namespace {
+
+// Output of `yes`: every line scrolls the whole screen.
+std::size_t yes_output()
+{
+    static auto const stream = [] {
+        auto out = std::string{};
+        for (int i = 0; i != 100'000; ++i)
+            out += "y\r\n";
+
+        return out;
+    }();
+
+    katerm::terminal_decoder decoder;
+    katerm::terminal term{{200, 100}};
+    katerm::terminal_instructee instructee{&term};
+    decoder.decode(stream.data(), static_cast<int>(stream.size()), instructee);
+
+    katerm::bench::do_not_optimize(&term);
+    return stream.size();
+}
+
+// Like a pager or tmux with a status line: lines scroll in a region that
+// leaves the last line of the screen alone.
+std::size_t region_scroll()
+{
+    static auto const stream = [] {
+        auto out = std::string{"\x1b[1;99r\x1b[99;1H"};
+        for (int i = 0; i != 100'000; ++i)
+            out += "y\r\n";
+
+        return out;
+    }();
+
+    katerm::terminal_decoder decoder;
+    katerm::terminal term{{200, 100}};
+    katerm::terminal_instructee instructee{&term};
+    decoder.decode(stream.data(), static_cast<int>(stream.size()), instructee);
+
+    katerm::bench::do_not_optimize(&term);
+    return stream.size();
+}
+
+// Full screen redraws on a wide terminal: clear, then a few short lines.
+std::size_t clear_and_redraw()
+{
+    static auto const stream = [] {
+        auto out = std::string{};
+        for (int i = 0; i != 10'000; ++i)
+            out += "\x1b[H\x1b[2Jtop\r\nmiddle\r\nbottom";
+
+        return out;
+    }();
+
+    katerm::terminal_decoder decoder;
+    katerm::terminal term{{400, 120}};
+    katerm::terminal_instructee instructee{&term};
+    decoder.decode(stream.data(), static_cast<int>(stream.size()), instructee);
+
+    katerm::bench::do_not_optimize(&term);
+    return stream.size();
+}
+
+// Reflowing a screen with a full scrollback of wrapped lines, bytes are the
+// text that's in the terminal.
+std::size_t reflow_history()
+{
+    static auto const stream = [] {
+        auto out = std::string{};
+        for (int i = 0; i != 50'000; ++i) {
+            out += "line " + std::to_string(i) + ' ';
+            out += std::string(static_cast<std::size_t>(60 + i % 60), 'x');
+            out += "\r\n";
+        }
+
+        return out;
+    }();
+
+    static auto const filled = [] {
+        katerm::terminal_decoder decoder;
+        katerm::terminal term{{80, 24}};
+        katerm::terminal_instructee instructee{&term};
+        decoder.decode(stream.data(), static_cast<int>(stream.size()), instructee);
+        return term;
+    }();
+
+    auto term = filled;
+    term.resize({100, 24});
+    term.resize({80, 24});
+
+    katerm::bench::do_not_optimize(&term);
+    return 2 * stream.size();
+}
+
+// Appending 200 column lines, bytes are counted as unpacked glyphs.
+std::size_t scrollback_append()
+{
+    static auto const line = std::vector<katerm::glyph>(
+                                200, katerm::glyph{katerm::default_style, 'x'});
+
+    auto history = katerm::scrollback{};
+    for (int i = 0; i != 10'000; ++i)
+        history.push_line(line.data(), static_cast<int>(line.size()));
+
+    katerm::bench::do_not_optimize(&history);
+    return 10'000 * line.size() * sizeof(katerm::glyph);
+}
+
+KATERM_BENCHMARK("yes full screen scroll", yes_output);
+KATERM_BENCHMARK("scroll region above a status line", region_scroll);
+KATERM_BENCHMARK("clear and redraw 400x120", clear_and_redraw);
+KATERM_BENCHMARK("reflow scrollback", reflow_history);
+KATERM_BENCHMARK("scrollback append 10k lines", scrollback_append);
+
+} // anonymous namespace
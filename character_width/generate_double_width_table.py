@@ -1,5 +1,6 @@
 import sys
 import argparse
+import os
 
 import parse_eaw
 import range_list
@@ -25,7 +26,7 @@ east_asian_width = parse_eaw.parse(args.input)
 width_table = range_list.transform_list(east_asian_width, eaw_to_width)
 
 with open(args.output, 'w') as output:
-    print(f'// This file was generated by {__file__}', file=output);
+    print(f'// This file was generated by {os.path.basename(__file__)}', file=output);
     count = 0
     for w in list(width_table):
         if w.property == 2:
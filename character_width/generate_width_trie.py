@@ -0,0 +1,111 @@
+import argparse
+import os
+
+import parse_cat
+import parse_eaw
+import range_list
+
+
+# Generates a two stage lookup table for the width of every code point.
+#
+# Code points are split in blocks of 256. The first stage maps the block
+# number (code point >> 8) to an index into the second stage, identical blocks
+# are only stored once. Every block in the second stage is 64 bytes, the
+# widths 0, 1 or 2 are packed 4 to a byte.
+#
+# Looking up a code point touches one byte in the first stage and one cache
+# line in the second.
+
+BLOCK_BITS = 8
+BLOCK_SIZE = 1 << BLOCK_BITS
+CODE_POINT_COUNT = 0x110000
+
+# Same as zero_width_misc in src/character_width.cpp
+# from https://github.com/jquast/wcwidth
+ZERO_WIDTH_MISC = [
+    0x034f, 0x200b, 0x200c, 0x200d, 0x200e, 0x200f, 0x2028, 0x2029,
+    0x202a, 0x202b, 0x202c, 0x202d, 0x202e, 0x2060, 0x2061, 0x2062,
+    0x2063,
+]
+
+
+def eaw_to_width(eaw):
+    return 2 if eaw in ['W', 'F'] else 1
+
+
+def cat_is_zero(cat):
+    return cat in ['Mn', 'Me']
+
+
+def widths(eaw_file, cat_file):
+    result = bytearray([1]) * CODE_POINT_COUNT
+
+    east_asian_width = parse_eaw.parse(eaw_file)
+    for r in range_list.transform_list(east_asian_width, eaw_to_width):
+        if r.property == 2:
+            result[r.range_start:r.range_end + 1] = bytes([2]) * (r.range_end + 1 - r.range_start)
+
+    # Zero width wins over double width, like in the range table search.
+    general_category = parse_cat.parse(cat_file)
+    for r in range_list.transform_list(general_category, cat_is_zero):
+        if r.property:
+            result[r.range_start:r.range_end + 1] = bytes(r.range_end + 1 - r.range_start)
+
+    for code in ZERO_WIDTH_MISC:
+        result[code] = 0
+
+    return result
+
+
+def pack_block(block):
+    packed = bytearray(len(block) // 4)
+    for i, width in enumerate(block):
+        packed[i // 4] |= width << ((i % 4) * 2)
+
+    return bytes(packed)
+
+
+parser = argparse.ArgumentParser(description='Generate width lookup table')
+parser.add_argument('--eaw-input', required=True)
+parser.add_argument('--cat-input', required=True)
+parser.add_argument('--output', required=True)
+
+args = parser.parse_args()
+
+all_widths = widths(args.eaw_input, args.cat_input)
+
+block_indices = {}
+stage1 = []
+stage2 = []
+for start in range(0, CODE_POINT_COUNT, BLOCK_SIZE):
+    block = pack_block(all_widths[start:start + BLOCK_SIZE])
+    if block not in block_indices:
+        block_indices[block] = len(stage2)
+        stage2.append(block)
+
+    stage1.append(block_indices[block])
+
+if len(stage2) > 256:
+    raise Exception(f'{len(stage2)} unique blocks don\'t fit in the 8 bit first stage')
+
+with open(args.output, 'w') as output:
+    print(f'// This file was generated by {os.path.basename(__file__)}', file=output)
+    print(f'// {len(stage1)} first stage entries, {len(stage2)} unique blocks', file=output)
+    print(file=output)
+
+    print(f'constexpr int width_block_bits = {BLOCK_BITS};', file=output)
+    print(file=output)
+
+    print(f'constexpr unsigned char width_stage1[{len(stage1)}] {{', file=output)
+    for i in range(0, len(stage1), 16):
+        print('   ' + ''.join(f' {b:3},' for b in stage1[i:i + 16]), file=output)
+    print('};', file=output)
+    print(file=output)
+
+    print(f'alignas(64) constexpr unsigned char width_stage2[{len(stage2)}][{BLOCK_SIZE // 4}] {{', file=output)
+    for block in stage2:
+        print('    {', file=output)
+        for i in range(0, len(block), 16):
+            print('       ' + ''.join(f' {b:#04x},' for b in block[i:i + 16]), file=output)
+        print('    },', file=output)
+    print('};', file=output)
@@ -1,12 +1,13 @@
 import sys
 import argparse
+import os
 
 import parse_cat
 import range_list
 
 
 def cat_is_zero(cat):
-    return cat in ['Mc', 'Me']
+    return cat in ['Mn', 'Me']
 
 
 parser = argparse.ArgumentParser(description='Generate zero width table')
@@ -19,7 +20,7 @@ general_category = parse_cat.parse(args.input)
 zero_width_table = range_list.transform_list(general_category, cat_is_zero)
 
 with open(args.output, 'w') as output:
-    print(f'// This file was generated by {__file__}', file=output);
+    print(f'// This file was generated by {os.path.basename(__file__)}', file=output);
     count = 0
     for w in zero_width_table:
         if w.property:
@@ -3,7 +3,52 @@
 
 namespace cw {
 
-int character_width(char32_t);
+namespace detail {
+
+// Lookup in the two stage table generated by generate_width_trie.py, for
+// code points that character_width doesn't classify inline.
+int table_width(char32_t);
+
+} // detail::
+
+// Number of columns the code point takes up, -1 for control characters.
+// The common blocks of the BMP are handled here so that callers can inline
+// them, everything else goes through the lookup table.
+inline int character_width(char32_t code)
+{
+    if (code < 0x80)
+        return code >= 0x20 ? 1 : code == 0 ? 0 : -1;
+
+    // c1 control codes
+    if (code < 0xa0)
+        return -1;
+
+    // Latin-1 Supplement up to Spacing Modifier Letters
+    if (code < 0x300)
+        return 1;
+
+    // Combining Diacritical Marks
+    if (code < 0x370)
+        return 0;
+
+    // Greek and Coptic, Cyrillic up to the combining marks
+    if (code < 0x483)
+        return 1;
+
+    // CJK Unified Ideographs Extension A, CJK Unified Ideographs
+    if ((code >= 0x3400 && code <= 0x4dbf) || (code >= 0x4e00 && code <= 0x9fff))
+        return 2;
+
+    // Hangul Syllables
+    if (code >= 0xac00 && code <= 0xd7a3)
+        return 2;
+
+    return detail::table_width(code);
+}
+
+// Same result as character_width, but using binary searches over the range
+// tables. Kept to test and benchmark the lookup table against.
+int character_width_search(char32_t);
 
 } // cw::
 
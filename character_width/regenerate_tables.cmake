@@ -0,0 +1,63 @@
+# Regenerates the checked in character width tables for a Unicode version.
+#
+# Usage:
+#   cmake -DUNICODE_VERSION=14.0.0 [-DUCD_DIR=<dir>] [-DPYTHON=<python>]
+#         -P regenerate_tables.cmake
+#
+# The Unicode data files are downloaded from unicode.org unless UCD_DIR points
+# to a directory that already has EastAsianWidth.txt and
+# DerivedGeneralCategory.txt. Tables are written to tables/<UNICODE_VERSION>.
+
+if(NOT UNICODE_VERSION)
+    message(FATAL_ERROR "UNICODE_VERSION must be set, for example -DUNICODE_VERSION=14.0.0")
+endif()
+
+if(NOT PYTHON)
+    find_program(PYTHON NAMES python3 python REQUIRED)
+endif()
+
+set(output_dir ${CMAKE_CURRENT_LIST_DIR}/tables/${UNICODE_VERSION})
+
+if(NOT UCD_DIR)
+    set(UCD_DIR ${CMAKE_CURRENT_BINARY_DIR}/ucd-${UNICODE_VERSION})
+    set(base_url https://www.unicode.org/Public/${UNICODE_VERSION}/ucd)
+
+    foreach(file EastAsianWidth.txt extracted/DerivedGeneralCategory.txt)
+        get_filename_component(name ${file} NAME)
+        if(NOT EXISTS ${UCD_DIR}/${name})
+            file(DOWNLOAD ${base_url}/${file} ${UCD_DIR}/${name} STATUS status)
+            list(GET status 0 status_code)
+            if(NOT status_code EQUAL 0)
+                file(REMOVE ${UCD_DIR}/${name})
+                message(FATAL_ERROR "Downloading ${base_url}/${file} failed: ${status}")
+            endif()
+        endif()
+    endforeach()
+endif()
+
+file(MAKE_DIRECTORY ${output_dir})
+
+function(run_generator)
+    execute_process(
+        COMMAND ${PYTHON} ${ARGN}
+        RESULT_VARIABLE result)
+
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${ARGN} failed")
+    endif()
+endfunction()
+
+run_generator(${CMAKE_CURRENT_LIST_DIR}/generate_double_width_table.py
+    --input ${UCD_DIR}/EastAsianWidth.txt
+    --output ${output_dir}/double_width_table.inc)
+
+run_generator(${CMAKE_CURRENT_LIST_DIR}/generate_zero_width_table.py
+    --input ${UCD_DIR}/DerivedGeneralCategory.txt
+    --output ${output_dir}/zero_width_table.inc)
+
+run_generator(${CMAKE_CURRENT_LIST_DIR}/generate_width_trie.py
+    --eaw-input ${UCD_DIR}/EastAsianWidth.txt
+    --cat-input ${UCD_DIR}/DerivedGeneralCategory.txt
+    --output ${output_dir}/width_trie.inc)
+
+message(STATUS "Wrote character width tables for Unicode ${UNICODE_VERSION} to ${output_dir}")
@@ -1,6 +1,8 @@
 #include <iterator>
 #include <algorithm>
 
+#include <cw/character_width.hpp>
+
 namespace cw {
 
 namespace {
@@ -22,6 +24,8 @@ code_point_range const zero_width_ranges[] {
 
 };
 
+#include <width_trie.inc>
+
 
 // Misc zero width table
 // from https://github.com/jquast/wcwidth
@@ -48,7 +52,18 @@ char32_t const zero_width_misc[]{
 
 } // anonymous namespace
 
-int character_width(char32_t code)
+int detail::table_width(char32_t code)
+{
+    if (code >= 0x110000)
+        return 1;
+
+    auto const block = width_stage1[code >> width_block_bits];
+    auto const offset = code & ((1u << width_block_bits) - 1);
+    auto const packed = width_stage2[block][offset / 4];
+    return (packed >> (offset % 4 * 2)) & 3;
+}
+
+int character_width_search(char32_t code)
 {
     // Handle ASCII stuff seperately for better performance
 
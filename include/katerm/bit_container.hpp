@@ -42,6 +42,16 @@ public:
         data &= ~bits.data;
     }
 
+    data_type raw() const
+    {
+        return data;
+    }
+
+    void set_raw(data_type const bits)
+    {
+        data = bits;
+    }
+
     friend bool operator==(bit_container left, bit_container right)
     {
         return left.data == right.data;
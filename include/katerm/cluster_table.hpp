@@ -0,0 +1,72 @@
+#ifndef KATERM_CLUSTER_TABLE_HPP
+#define KATERM_CLUSTER_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "glyph.hpp"
+#include "packed_glyph.hpp"
+
+namespace katerm {
+
+// Grapheme clusters of more than one code point: a base character with
+// combining marks, variation selectors or joined emoji. A glyph with
+// glyph_attr_bit::cluster set stores a cluster id in its code instead of a
+// code point.
+//
+// Clusters are interned, so a screen full of the same emoji stores it once.
+// Code points of all clusters are kept back to back in one vector, nothing is
+// allocated per cell. Ids stay valid for the lifetime of the table.
+//
+// Clusters are never removed: the history and older frames can still refer
+// to any of them, and their glyphs can't be renumbered. A table only grows,
+// up to max_clusters of at most max_cluster_length code points. After that
+// new clusters aren't added and writing drops their extra code points.
+// Output normally repeats a small set of clusters, so that limit is for
+// hostile input.
+class cluster_table {
+public:
+    using id_type = std::uint32_t;
+
+    // Ids have to fit the code of a packed_glyph, 0 isn't used.
+    static constexpr std::size_t max_clusters = packed_glyph::code_mask;
+
+    // Code points past this are dropped, a cluster can't be made to grow
+    // without bound.
+    static constexpr int max_cluster_length = 32;
+
+    struct cluster {
+        code_point const* code_points;
+        int count;
+    };
+
+private:
+    std::vector<code_point> m_code_points;
+
+    // Start of cluster id in m_code_points, one past the end for the last.
+    std::vector<std::uint32_t> m_offsets;
+
+    // Hash of the code points to the ids with that hash.
+    std::unordered_multimap<std::size_t, id_type> m_lookup;
+
+public:
+    cluster_table();
+
+    // Returns the id for the cluster, or 0 when it isn't in the table.
+    id_type find(code_point const* code_points, int count) const;
+
+    // Returns the id for the cluster, adding it when it's new. Returns 0,
+    // which is never a valid id, when the table is full.
+    id_type intern(code_point const* code_points, int count);
+
+    cluster get(id_type id) const;
+
+    // Number of clusters
+    std::size_t size() const;
+};
+
+} // katerm::
+
+#endif // header guard
@@ -0,0 +1,51 @@
+#ifndef KATERM_COMPACT_SCREEN_HPP
+#define KATERM_COMPACT_SCREEN_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "glyph.hpp"
+#include "packed_glyph.hpp"
+#include "terminal_screen.hpp"
+
+namespace katerm {
+
+// Screen contents stored as packed_glyph, 8 bytes per cell instead of 12.
+// Glyphs are returned by value since they don't exist in unpacked form.
+//
+// This is a snapshot, terminal_screen never stores its lines like this. It's
+// meant for parking idle terminals: copy the screen out, shrink the
+// terminal_screen, and copy_to a screen of the same size when output
+// arrives again. The terminal writes through glyph pointers into its lines,
+// so packing live lines would mean a palette lookup for every write.
+class compact_screen {
+private:
+    extend m_size;
+    colour_palette m_palette;
+    std::vector<packed_glyph> cells;
+
+    // Glyphs of cells whose colours didn't fit into the palette, these cells
+    // have colour_palette::no_index as their colours.
+    std::unordered_map<std::size_t, glyph> m_overflow;
+
+public:
+    compact_screen(extend screen_sz);
+    explicit compact_screen(terminal_screen const& screen);
+
+    glyph get_glyph(position pos) const;
+    void set_glyph(position pos, glyph const& g);
+
+    // Writes the contents back into a screen of the same size.
+    void copy_to(terminal_screen& screen) const;
+
+    extend size() const;
+    colour_palette const& palette() const;
+
+private:
+    void store(std::size_t cell, glyph const& g);
+};
+
+} // katerm::
+
+#endif // header guard
@@ -0,0 +1,90 @@
+#ifndef KATERM_FRAME_HPP
+#define KATERM_FRAME_HPP
+
+#include <memory>
+#include <vector>
+
+#include "cluster_table.hpp"
+#include "glyph.hpp"
+#include "terminal.hpp"
+#include "terminal_data.hpp"
+
+namespace katerm {
+
+struct frame_diff;
+
+// Immutable copy of what the terminal shows. Lines are shared between
+// consecutive frames when they didn't change, so copying a frame and taking
+// a new one after a few writes is cheap. Frames can be handed to another
+// thread and read there while the terminal keeps decoding.
+class frame {
+private:
+    struct frame_line {
+        // Only the used part, the rest of the line is fill.
+        std::vector<glyph> glyphs;
+        glyph fill;
+    };
+
+    extend m_size{0, 0};
+    terminal_cursor m_cursor{};
+    terminal_mode m_mode{};
+
+    // Number of the frame in its chain and total lines scrolled up since
+    // the first frame, in any region.
+    long long m_sequence = 0;
+    long long m_scrolled = 0;
+
+    // Region of the last scroll, all scrolls in frames from m_region_since
+    // up to this one were in it.
+    int m_scroll_top = 0;
+    int m_scroll_bottom = 0;
+    long long m_region_since = 0;
+
+    std::vector<std::shared_ptr<frame_line const>> m_lines;
+    std::shared_ptr<cluster_table const> m_clusters;
+
+    friend frame snapshot(terminal& term, frame const& previous);
+    friend frame_diff diff(frame const& from, frame const& to);
+
+public:
+    frame() = default;
+
+    extend size() const;
+    terminal_cursor const& cursor() const;
+    terminal_mode mode() const;
+
+    glyph const& get_glyph(position pos) const;
+
+    // For glyphs with glyph_attr_bit::cluster
+    cluster_table const& clusters() const;
+
+    // Same as terminal_screen, glyphs past line_length are line_fill.
+    glyph const* get_line(int line) const;
+    int line_length(int line) const;
+    glyph const& line_fill(int line) const;
+};
+
+// What a renderer showing from has to do to show to.
+struct frame_diff {
+    // Move lines [scroll_top, scroll_bottom) up by scroll lines first, or
+    // down when it's negative. The lines coming in are listed in lines.
+    int scroll = 0;
+    int scroll_top = 0;
+    int scroll_bottom = 0;
+
+    // Lines of to that differ from the scrolled from, in ascending order.
+    std::vector<int> lines;
+};
+
+// Captures the terminal, sharing the lines that didn't change with previous.
+// This consumes the screen's changes, so previous must be the last frame
+// taken of this terminal or an empty frame.
+frame snapshot(terminal& term, frame const& previous = frame{});
+
+// from must be an earlier frame of the same chain as to, frames don't need
+// to be consecutive.
+frame_diff diff(frame const& from, frame const& to);
+
+} // katerm::
+
+#endif // header guard
@@ -8,12 +8,13 @@
 
 namespace katerm {
 
-enum class glyph_attr_bit {
+enum class glyph_attr_bit : std::uint16_t {
     text_wraps = 1 << 0,
     wide       = 1 << 1,
     wdummy     = 1 << 2, // space occupied by previous wide character
     reversed   = 1 << 3,
     bold       = 1 << 4,
+    cluster    = 1 << 5, // code is an id in the screen's cluster_table
 };
 
 class glyph_attribute : public bit_container<glyph_attr_bit> {
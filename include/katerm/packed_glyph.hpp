@@ -0,0 +1,118 @@
+#ifndef KATERM_PACKED_GLYPH_HPP
+#define KATERM_PACKED_GLYPH_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "glyph.hpp"
+
+namespace katerm {
+
+// Maps colours to 16 bit indices so that cells don't have to store them.
+// Indices are reference counted, a colour nothing references anymore frees
+// its index for the next new colour.
+class colour_palette {
+public:
+    using index_type = std::uint16_t;
+
+    // Never a valid index, intern returns it when the palette is full.
+    static constexpr index_type no_index = 0xffff;
+    static constexpr std::size_t max_colours = no_index;
+
+private:
+    std::vector<colour> colours;
+    std::vector<std::uint32_t> references;
+    std::vector<index_type> free_indices;
+    std::unordered_map<std::uint32_t, index_type> lookup;
+
+public:
+    // Returns the index for c and counts a reference to it, adding it when
+    // it's new. Returns no_index when the palette is full, the caller has to
+    // keep the colour some other way.
+    index_type intern(colour c);
+
+    // Counts more references to an index returned by intern.
+    void retain(index_type index, std::size_t count = 1);
+    void release(index_type index);
+
+    colour get(index_type index) const;
+
+    // Number of colours that are referenced
+    std::size_t size() const;
+
+    // Approximate heap memory used, including the lookup table.
+    std::size_t memory_usage() const;
+};
+
+// 8 byte glyph: 21 bit code point and 11 bits of attributes, foreground and
+// background are indices into a colour_palette.
+class packed_glyph {
+public:
+    static constexpr int code_bits = 21;
+    static constexpr std::uint32_t code_mask = (1u << code_bits) - 1;
+
+private:
+    std::uint32_t code_and_mode = 0;
+    colour_palette::index_type fg = 0;
+    colour_palette::index_type bg = 0;
+
+public:
+    packed_glyph() = default;
+
+    packed_glyph(
+            code_point const code,
+            glyph_attribute const mode,
+            colour_palette::index_type const fg,
+            colour_palette::index_type const bg)
+        : code_and_mode{(code & code_mask)
+                        | static_cast<std::uint32_t>(mode.raw()) << code_bits}
+        , fg{fg}
+        , bg{bg}
+    {
+    }
+
+    // Packs g with its colours interned in palette. Returns false and leaves
+    // palette unchanged when the colours don't fit.
+    static bool pack(glyph const& g, colour_palette& palette, packed_glyph& out);
+
+    glyph unpack(colour_palette const& palette) const;
+
+    code_point code() const
+    {
+        return code_and_mode & code_mask;
+    }
+
+    glyph_attribute mode() const
+    {
+        auto mode = glyph_attribute{};
+        mode.set_raw(static_cast<std::uint16_t>(code_and_mode >> code_bits));
+        return mode;
+    }
+
+    colour_palette::index_type fg_index() const
+    {
+        return fg;
+    }
+
+    colour_palette::index_type bg_index() const
+    {
+        return bg;
+    }
+
+    friend bool operator==(packed_glyph const& a, packed_glyph const& b)
+    {
+        return a.code_and_mode == b.code_and_mode && a.fg == b.fg && a.bg == b.bg;
+    }
+
+    friend bool operator!=(packed_glyph const& a, packed_glyph const& b)
+    {
+        return !(a == b);
+    }
+};
+
+static_assert(sizeof(packed_glyph) == 8);
+
+} // katerm::
+
+#endif // header guard
@@ -0,0 +1,118 @@
+#ifndef KATERM_PIPELINE_HPP
+#define KATERM_PIPELINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "frame.hpp"
+#include "terminal.hpp"
+#include "terminal_decoder.hpp"
+
+namespace katerm {
+
+// Fixed size byte queue for one producer thread and one consumer thread.
+// Neither side ever waits for the other, a full ring just accepts fewer
+// bytes.
+class byte_ring {
+private:
+    // Rounded up to a power of two.
+    std::size_t m_capacity;
+    std::unique_ptr<char[]> m_data;
+
+    // Total bytes ever written and read, on separate cache lines so the two
+    // threads don't keep stealing them from each other.
+    alignas(64) std::atomic<std::size_t> m_written{0};
+    alignas(64) std::atomic<std::size_t> m_read{0};
+
+public:
+    explicit byte_ring(std::size_t capacity);
+
+    // Producer: copies as many bytes as fit and returns how many that was.
+    std::size_t write(char const* bytes, std::size_t count);
+
+    // Consumer: sets bytes to the longest contiguous run of unread bytes and
+    // returns its length. They stay in the ring until consumed.
+    std::size_t peek(char const*& bytes) const;
+    void consume(std::size_t count);
+
+    std::size_t capacity() const;
+};
+
+// Hands the newest frame from one producer thread to one consumer thread with
+// three slots. The producer always has a slot of its own to publish into and
+// the consumer keeps reading its slot until it asks for a newer one, so
+// neither ever waits. Frames published in between are skipped.
+class frame_mailbox {
+private:
+    static constexpr int fresh_bit = 4;
+    static constexpr int index_mask = 3;
+
+    frame m_slots[3];
+
+    int m_back = 0;   // Owned by the producer
+    int m_front = 1;  // Owned by the consumer
+
+    // The slot in between, with fresh_bit set when the consumer hasn't
+    // taken it yet.
+    std::atomic<int> m_middle{2};
+
+public:
+    // Producer
+    void publish(frame f);
+
+    // Consumer: switches to the newest published frame, returns false if
+    // there wasn't a new one.
+    bool update();
+    frame const& current() const;
+};
+
+// Decoding on one thread, reading from the PTY on a second and rendering on a
+// third without a lock around the terminal:
+//
+//  - The reader thread calls feed with the bytes it read.
+//  - The decoder thread calls process, which decodes the fed bytes and
+//    publishes a frame of the result. It owns the terminal.
+//  - The renderer thread calls update and draws current. Drawing only needs
+//    diff(previous, current) of the frames.
+//
+// Waking the threads up is left to the embedder's event loop.
+class terminal_pipeline {
+public:
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+private:
+    byte_ring m_input;
+
+    terminal m_term;
+    terminal_decoder m_decoder;
+    frame m_last;
+
+    frame_mailbox m_frames;
+
+public:
+    explicit terminal_pipeline(
+            extend screen_size,
+            std::size_t buffer_size = default_buffer_size);
+
+    // Reader thread: returns how many of the bytes were accepted, the rest
+    // have to be fed again once the decoder caught up.
+    std::size_t feed(char const* bytes, std::size_t count);
+
+    // Decoder thread: decodes everything fed so far, returns the number of
+    // bytes decoded. A frame is published when that's not zero.
+    std::size_t process();
+
+    // Decoder thread: changes made through this are published by the next
+    // publish or process that decodes something.
+    terminal& term();
+    void publish();
+
+    // Renderer thread
+    bool update();
+    frame const& current() const;
+};
+
+} // katerm::
+
+#endif // header guard
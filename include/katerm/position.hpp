@@ -20,7 +20,27 @@ struct position {
     }
 };
 
+// Columns [x_beg, x_end) of lines [y_beg, y_end)
+struct rect {
+    int x_beg;
+    int x_end;
+    int y_beg;
+    int y_end;
+
+    friend bool operator==(rect left, rect right)
+    {
+        return left.x_beg == right.x_beg && left.x_end == right.x_end
+            && left.y_beg == right.y_beg && left.y_end == right.y_end;
+    }
+
+    friend bool operator!=(rect left, rect right)
+    {
+        return !(left == right);
+    }
+};
+
 std::ostream& operator<<(std::ostream&, position);
+std::ostream& operator<<(std::ostream&, rect);
 
 } // katerm::
 
@@ -0,0 +1,99 @@
+#ifndef KATERM_PRINTABLE_SCAN_HPP
+#define KATERM_PRINTABLE_SCAN_HPP
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define KATERM_SCAN_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KATERM_SCAN_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace katerm {
+
+namespace detail {
+
+inline int count_trailing_zeros(std::uint32_t const value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+constexpr bool is_printable_ascii(char const c)
+{
+    return c >= 0x20 && c <= 0x7e;
+}
+
+} // detail::
+
+// Returns a pointer to the first byte in [begin, end) that is not printable
+// ASCII (0x20..0x7e), or end if the whole range is printable.
+inline char const* find_printable_end(char const* begin, char const* const end)
+{
+#if defined(KATERM_SCAN_AVX2)
+    auto const low32 = _mm256_set1_epi8(0x1f);
+    auto const high32 = _mm256_set1_epi8(0x7f);
+
+    while (end - begin >= 32) {
+        auto const bytes = _mm256_loadu_si256(
+                                reinterpret_cast<__m256i const*>(begin));
+
+        // Signed compares: bytes >= 0x80 are negative and fail the first test.
+        auto const printable = _mm256_and_si256(
+                                _mm256_cmpgt_epi8(bytes, low32),
+                                _mm256_cmpgt_epi8(high32, bytes));
+
+        auto const mask = static_cast<std::uint32_t>(
+                                _mm256_movemask_epi8(printable));
+
+        if (mask != 0xffff'ffff)
+            return begin + detail::count_trailing_zeros(~mask);
+
+        begin += 32;
+    }
+#endif
+
+#if defined(KATERM_SCAN_SSE2)
+    auto const low16 = _mm_set1_epi8(0x1f);
+    auto const high16 = _mm_set1_epi8(0x7f);
+
+    while (end - begin >= 16) {
+        auto const bytes = _mm_loadu_si128(
+                                reinterpret_cast<__m128i const*>(begin));
+
+        auto const printable = _mm_and_si128(
+                                _mm_cmpgt_epi8(bytes, low16),
+                                _mm_cmplt_epi8(bytes, high16));
+
+        auto const mask = static_cast<std::uint32_t>(
+                                _mm_movemask_epi8(printable));
+
+        if (mask != 0xffff)
+            return begin + detail::count_trailing_zeros(~mask & 0xffff);
+
+        begin += 16;
+    }
+#endif
+
+    while (begin != end && detail::is_printable_ascii(*begin))
+        ++begin;
+
+    return begin;
+}
+
+} // katerm::
+
+#endif // header guard
@@ -0,0 +1,102 @@
+#ifndef KATERM_SCROLLBACK_HPP
+#define KATERM_SCROLLBACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "glyph.hpp"
+#include "packed_glyph.hpp"
+
+namespace katerm {
+
+// Lines that scrolled off the top of the screen.
+// Glyphs are stored packed in fixed size chunks, so appending never moves
+// existing history. When the memory limit is reached the oldest chunk is
+// dropped together with its lines.
+//
+// Only the newest chunks are kept as glyphs, with a colour palette of their
+// own. Older ones are encoded as style runs with the colours written out and
+// repeated trailing glyphs dropped, and lines are decoded from that when
+// read. Palettes are dropped with their chunks, so they are bounded by the
+// chunk size and counted in the memory usage.
+class scrollback {
+public:
+    // Glyphs per chunk, lines longer than this get a chunk of their own.
+    static constexpr std::size_t chunk_glyphs = 8192;
+    static constexpr std::size_t hot_chunks = 2;
+    static constexpr std::size_t default_max_bytes = 4 << 20;
+
+    // Longer lines are encoded right away, a palette can't hold all of the
+    // colours they might use.
+    static constexpr std::size_t max_hot_line = (colour_palette::max_colours - 2) / 2;
+
+private:
+    struct line_ref {
+        std::size_t chunk; // Counted from the first chunk ever allocated
+        std::uint32_t offset; // Into glyphs, or into encoded once cold
+        std::uint32_t length;
+    };
+
+    struct chunk {
+        // Capacity is reserved up front and never exceeded.
+        std::vector<packed_glyph> glyphs;
+        colour_palette palette;
+        std::size_t palette_bytes = 0; // Counted in used_bytes
+        std::vector<std::uint8_t> encoded;
+        bool cold = false;
+    };
+
+    std::deque<chunk> chunks;
+    std::size_t first_chunk = 0;
+
+    std::deque<line_ref> lines;
+
+    std::size_t max_bytes;
+    std::size_t used_bytes = 0;
+
+    // Since the last clear, evicting lines doesn't lower them.
+    bool any_wrapped = false;
+    std::size_t longest = 0;
+
+public:
+    explicit scrollback(std::size_t max_bytes = default_max_bytes);
+
+    void push_line(glyph const* glyphs, int count);
+
+    // Number of lines, index 0 is the oldest line.
+    std::size_t size() const;
+    int line_length(std::size_t index) const;
+
+    // Old lines are decoded up to x for every call, O(x).
+    glyph get_glyph(std::size_t index, int x) const;
+
+    // Whether a line that soft wraps into the next was pushed, and the length
+    // of the longest line. Both are only reset by clear, lines that were
+    // dropped since still count.
+    bool has_wrapped_lines() const;
+    std::size_t longest_line() const;
+
+    // Appends the glyphs of the line to out. Decodes the line once, use this
+    // rather than get_glyph to read whole lines.
+    void read_line(std::size_t index, std::vector<glyph>& out) const;
+
+    // A limit of 0 disables the scrollback.
+    // At least one chunk is kept while the limit is not 0.
+    void set_max_bytes(std::size_t bytes);
+    std::size_t max_memory() const;
+    std::size_t memory_usage() const;
+
+    void clear();
+
+private:
+    void push_hot_line(glyph const* glyphs, std::size_t length);
+    void push_cold_line(glyph const* glyphs, std::size_t length);
+    void make_cold(std::size_t chunk_index);
+    void evict();
+};
+
+} // katerm::
+
+#endif // header guard
@@ -0,0 +1,72 @@
+#ifndef KATERM_STATS_HPP
+#define KATERM_STATS_HPP
+
+#include <cstdint>
+
+// Counters of what went through the decoder and the terminal, for finding out
+// what a stream that was slow to process contained.
+//
+// Only counted when KATERM_STATS is defined (the CMake option of the same
+// name), otherwise KATERM_COUNT compiles to nothing, its arguments aren't
+// evaluated and all counters stay 0. The structs are there either way so that
+// the layout of the classes holding them doesn't depend on the option.
+#ifdef KATERM_STATS
+#define KATERM_COUNT(counter, amount) ((counter) += (amount))
+#else
+#define KATERM_COUNT(counter, amount) ((void)0)
+#endif
+
+namespace katerm {
+
+#ifdef KATERM_STATS
+inline constexpr bool stats_enabled = true;
+#else
+inline constexpr bool stats_enabled = false;
+#endif
+
+// Snapshots are plain copies, take two and subtract to get a rate.
+struct decoder_stats {
+    std::uint64_t bytes = 0;
+    std::uint64_t decode_calls = 0;
+
+    // Decode calls that ended in the middle of a sequence or control string,
+    // the decoder carries its state over to the next call.
+    std::uint64_t split_sequences = 0;
+
+    // Escape sequences other than CSI and control strings
+    std::uint64_t escapes = 0;
+
+    // Dispatched CSI sequences, by final byte at final - 0x40.
+    std::uint64_t csi = 0;
+    std::uint64_t csi_by_final[0x3f]{};
+
+    // Parameters of SGR (CSI m) sequences
+    std::uint64_t sgr_params = 0;
+
+    // OSC and the other control strings (DCS, SOS, PM, APC), and the bytes in
+    // them including the terminator.
+    std::uint64_t osc = 0;
+    std::uint64_t other_strings = 0;
+    std::uint64_t string_bytes = 0;
+};
+
+struct screen_stats {
+    std::uint64_t scroll_ups = 0;
+    std::uint64_t scroll_downs = 0;
+    std::uint64_t lines_scrolled = 0;
+
+    // Lines that went from clean to dirty
+    std::uint64_t lines_dirtied = 0;
+};
+
+struct terminal_stats {
+    screen_stats screen;
+
+    // Characters written while insert mode was set, these shift the rest of
+    // the line and can't take the bulk write path.
+    std::uint64_t insert_mode_chars = 0;
+};
+
+} // katerm::
+
+#endif // header guard
@@ -25,6 +25,13 @@ private:
         charset::usa, charset::usa};
     int using_translation_table = 0;
 
+    // Lines [scroll_top, scroll_bottom) scroll on line feeds and are moved
+    // by inserting and deleting lines, set with DECSTBM.
+    int scroll_top = 0;
+    int scroll_bottom = screen.size().height;
+
+    std::uint64_t insert_mode_chars = 0;
+
 public:
     terminal() = default;
     terminal(extend screen_size)
@@ -39,29 +46,54 @@ public:
     void tab();
     void newline(bool first_column);
     void write_char(code_point ch);
+
+    // Equivalent to calling write_char for each character, but fills the
+    // line a segment at a time. Only wrapping and wide characters take the
+    // slow path.
+    void write_chars(code_point const* chars, int count);
+    void write_ascii(char const* chars, int count);
+
     void move_cursor(position pos);
     void move_cursor_forward(int width);
     void set_char(code_point ch, int width, glyph_style style, position pos);
     glyph* glyph_at_cursor();
     void mark_dirty(int line);
     void mark_dirty(int line_beg, int line_end);
-    void scroll_up(int keep_top=0, int count=1);
-    void scroll_down(int keep_top=0, int count=1);
+    // Scrolls the scroll region
+    void scroll_up(int count=1);
+    void scroll_down(int count=1);
+
+    // Margins are 0-based and bottom is exclusive, a bottom of 0 is the end
+    // of the screen. Regions of less than two lines are ignored.
+    void set_scroll_region(int top, int bottom);
+    int scroll_region_top() const;
+    int scroll_region_bottom() const;
+
     void clear_lines(int line_beg, int line_end);
     void clear(position start, position end);
     void delete_chars(int count);
     void insert_blanks(int count);
     void insert_newline(int count);
+    void delete_lines(int count);
+    void reverse_newline();
     void reset_style();
 
     glyph_style clear_style() const;
     glyph clear_glyph() const;
 
+    // Counters since construction, all 0 without KATERM_STATS.
+    terminal_stats stats() const;
+
 private:
     position clamp_pos(position p) const;
+
+    // Where the last glyph was written, false at the start of a line.
+    bool previous_glyph_pos(position& pos) const;
+    bool follows_joiner() const;
+    void add_to_cluster(code_point ch);
 };
 
-struct terminal_instructee : decoder_instructee {
+struct terminal_instructee final : decoder_instructee {
     terminal* term;
 
     terminal_instructee(terminal* tm)
@@ -74,6 +106,8 @@ struct terminal_instructee : decoder_instructee {
     void carriage_return() override;
     void backspace() override;
     void write_char(code_point code) override;
+    void write_chars(code_point const* chars, int count) override;
+    void write_ascii(char const* chars, int count) override;
     void clear_to_bottom() override;
     void clear_from_top() override;
     void clear_screen() override;
@@ -91,6 +125,7 @@ struct terminal_instructee : decoder_instructee {
     void reverse_line_feed() override;
     void insert_blanks(int count) override;
     void insert_newline(int count) override;
+    void set_scroll_region(int top, int bottom) override;
     void set_charset_table(int table_index, charset cs) override;
     void use_charset_table(int table_index) override;
     void reset_style() override;
@@ -105,6 +140,12 @@ struct terminal_instructee : decoder_instructee {
     void set_bracketed_paste(bool set) override;
 };
 
+// Decoder that calls terminal_instructee directly instead of going through
+// decoder_instructee's vtable.
+extern template class basic_decoder<terminal_instructee>;
+
+using terminal_decoder = basic_decoder<terminal_instructee>;
+
 
 } // katerm::
 
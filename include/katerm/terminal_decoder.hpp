@@ -1,10 +1,11 @@
 #ifndef KATERM_TERMINAL_DECODER_HPP
 #define KATERM_TERMINAL_DECODER_HPP
 
-#include <string>
+#include <cstddef>
 
 #include "glyph.hpp"
 #include "position.hpp"
+#include "stats.hpp"
 #include "terminal_data.hpp"
 
 namespace katerm {
@@ -13,6 +14,77 @@ enum class direction {
     up, down, forward, back
 };
 
+// Parameters of a CSI sequence. Sub-parameters separated by ':', like in
+// CSI 38:2::255:128:0 m, belong to the parameter before them. Parameters and
+// sub-parameters that don't fit are dropped.
+struct csi_params {
+    static constexpr int max_params = 16;
+    static constexpr int max_values = 32;
+
+    // Each parameter followed by its sub-parameters
+    int values[max_values]{};
+    int value_count = 0;
+
+    // Index of parameter i in values, first[count] is value_count.
+    unsigned char first[max_params + 1]{};
+    int count = 0;
+
+    // Set once a parameter was dropped, its sub-parameters are dropped too.
+    bool overflow = false;
+
+    int size() const { return count; }
+
+    // Parameter i, default_ when it's missing or 0.
+    int get(int const i, int const default_ = 0) const
+    {
+        if (i < count && values[first[i]] != 0)
+            return values[first[i]];
+
+        return default_;
+    }
+
+    int sub_count(int const i) const
+    {
+        return i < count ? first[i + 1] - first[i] - 1 : 0;
+    }
+
+    // Sub-parameter j of parameter i, default_ when it's missing or 0.
+    int get_sub(int const i, int const j, int const default_ = 0) const
+    {
+        if (j < sub_count(i) && values[first[i] + 1 + j] != 0)
+            return values[first[i] + 1 + j];
+
+        return default_;
+    }
+
+    void clear()
+    {
+        value_count = 0;
+        count = 0;
+        overflow = false;
+    }
+
+    void push(int const value)
+    {
+        if (count == max_params || value_count == max_values) {
+            overflow = true;
+            return;
+        }
+
+        values[value_count++] = value;
+        first[++count] = static_cast<unsigned char>(value_count);
+    }
+
+    void push_sub(int const value)
+    {
+        if (overflow || count == 0 || value_count == max_values)
+            return;
+
+        values[value_count++] = value;
+        first[count] = static_cast<unsigned char>(value_count);
+    }
+};
+
 class decoder_instructee {
 public:
     virtual void tab() = 0;
@@ -20,6 +92,13 @@ public:
     virtual void carriage_return() = 0;
     virtual void backspace() = 0;
     virtual void write_char(code_point code) = 0;
+
+    // Called with runs of decoded characters.
+    // The defaults call write_char for every character.
+    virtual void write_chars(code_point const* chars, int count);
+    // Only printable ASCII (0x20..0x7e)
+    virtual void write_ascii(char const* chars, int count);
+
     virtual void clear_to_bottom() = 0;
     virtual void clear_from_top() = 0;
     virtual void clear_screen() = 0;
@@ -37,6 +116,10 @@ public:
     virtual void reverse_line_feed() = 0;
     virtual void insert_blanks(int count) = 0;
     virtual void insert_newline(int count) = 0;
+
+    // Lines [top, bottom) become the scroll region, a bottom of 0 is the end
+    // of the screen.
+    virtual void set_scroll_region(int top, int bottom) = 0;
     virtual void set_charset_table(int table_index, charset cs) = 0;
     virtual void use_charset_table(int table_index) = 0;
     virtual void reset_style() = 0;
@@ -49,16 +132,88 @@ public:
     virtual void set_mouse_mode(mouse_mode, bool set) = 0;
     virtual void set_mouse_mode_extended(bool set) = 0;
     virtual void set_bracketed_paste(bool set) = 0;
+
+    // Called for CSI sequences the decoder doesn't handle, private_marker is
+    // one of < = > ? or 0. Does nothing by default.
+    virtual void unhandled_csi(char private_marker, char final, csi_params const& params);
+};
+
+enum class parser_state : unsigned char {
+    ground,
+    utf8,
+    escape,
+    escape_intermediate,
+    charset,
+    csi_entry,
+    csi_param,
+    csi_intermediate,
+    csi_ignore,
+    control_string,
+    control_string_overflow,
+};
+
+// Everything needed to continue a sequence that was split across decode calls.
+// Modelled after the parser described on https://vt100.net/emu/dec_ansi_parser
+struct decoder_state {
+    parser_state state = parser_state::ground;
+
+    // Code point being assembled and number of continuation bytes still
+    // expected, when state is utf8.
+    code_point utf8_code = 0;
+    int utf8_bytes_left = 0;
+
+    // Table being designated by ESC ( ) * +
+    int charset_table = 0;
+
+    char csi_private = 0;
+    bool csi_intermediate = false;
+    bool csi_has_params = false;
+    // Digits are accumulated into csi_param_value, which goes into csi when
+    // the ; or : after it or the final byte arrives. csi_sub is set after a :
+    bool csi_sub = false;
+    int csi_param_value = 0;
+    csi_params csi;
+
+    // Length of the control string so far, when state is control_string.
+    std::size_t string_length = 0;
+
+    // Only counted with KATERM_STATS
+    decoder_stats stats;
 };
 
-class decoder {
+// Instructee can be any type with the member functions of decoder_instructee.
+// With a concrete type instead of the decoder_instructee interface calls don't
+// go through the vtable and can be inlined.
+template<class Instructee>
+class basic_decoder {
 private:
-    std::string buffer;
+    decoder_state state;
+
+    std::size_t max_string_length = 1 << 16;
+    std::size_t overlong_strings = 0;
 
 public:
-    void decode(char const* bytes, int count, decoder_instructee& t);
+    // Decodes all bytes passed in. Bytes are never looked at twice, an
+    // incomplete sequence at the end is continued on the next call.
+    void decode(char const* bytes, int count, Instructee& t);
+
+    // Control strings (OSC, DCS, APC, PM, SOS) that go past this length are
+    // discarded in the control_string_overflow state until they terminate.
+    void set_max_string_length(std::size_t length);
+
+    // Number of control strings that went past the maximum length.
+    std::size_t overlong_string_count() const;
+
+    // Counters since construction, all 0 without KATERM_STATS.
+    decoder_stats const& stats() const;
 };
 
+extern template class basic_decoder<decoder_instructee>;
+
+using decoder = basic_decoder<decoder_instructee>;
+
 } // katerm::
 
+#include "terminal_decoder_impl.hpp"
+
 #endif // header guard
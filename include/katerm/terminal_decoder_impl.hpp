@@ -0,0 +1,899 @@
+#ifndef KATERM_TERMINAL_DECODER_IMPL_HPP
+#define KATERM_TERMINAL_DECODER_IMPL_HPP
+
+// Implementation of basic_decoder, included by terminal_decoder.hpp
+
+#include <algorithm>
+
+#include "colours.hpp"
+#include "printable_scan.hpp"
+
+namespace katerm {
+
+namespace detail {
+
+inline constexpr char esc = '\x1b';
+inline constexpr char can = '\x18';
+inline constexpr char sub = '\x1a';
+
+inline constexpr int max_utf8_run = 64;
+
+// Larger parameters are clamped to this
+inline constexpr int max_csi_param_value = 65535;
+
+inline constexpr code_point replacement_character = 0xfffd;
+
+// You can think of the COMMON_PARAMS as being the member variables.
+// Except that they are copied between function calls.
+// This encourages the compiler to keep this stuff in registers and allows it to
+// optimize more.
+// Each decode_ function consumes bytes for as long as it stays in the states it
+// handles and returns the index of the first byte it didn't consume.
+#define COMMON_PARAMS             \
+    const char* const bytes,      \
+    std::size_t const size,       \
+    std::size_t index,            \
+    decoder_state& s,             \
+    Instructee& t
+
+#define ARGS    \
+    bytes,      \
+    size,       \
+    index,      \
+    s,          \
+    t
+
+template<class Instructee>
+std::size_t decode_ground(COMMON_PARAMS);
+
+template<class Instructee>
+std::size_t decode_utf8(COMMON_PARAMS);
+
+template<class Instructee>
+std::size_t decode_utf8_continuation(COMMON_PARAMS);
+
+template<class Instructee>
+std::size_t decode_sequence(COMMON_PARAMS);
+
+// Control strings only need the decoder state, nothing is sent to the
+// instructee.
+inline std::size_t discard_string(
+        char const* bytes,
+        std::size_t size,
+        std::size_t index,
+        decoder_state& s);
+
+template<class Instructee>
+bool execute(decoder_state& s, Instructee& t, char const c);
+
+template<class Instructee>
+void decode_escape(decoder_state& s, Instructee& t, char const c);
+
+template<class Instructee>
+void decode_set_charset_table(decoder_state& s, Instructee& t, char const c);
+
+template<class Instructee>
+void decode_csi(decoder_state& s, Instructee& t, char const c);
+
+template<class Instructee>
+void dispatch_csi(decoder_state& s, Instructee& t, char const final);
+
+template<class Instructee>
+void decode_csi_priv(
+        Instructee& t,
+        csi_params const& params,
+        char const final);
+
+template<class Instructee>
+void decode_csi_pub(
+        Instructee& t,
+        csi_params const& params,
+        char const final);
+
+template<class Instructee>
+void decode_set_graphics(Instructee& t, csi_params const& params);
+
+template<class Instructee>
+void decode_private_set(
+        Instructee& t,
+        csi_params const& params,
+        bool const set);
+
+template<class Instructee>
+void decode_public_set(
+        Instructee& t,
+        csi_params const& params,
+        bool const set);
+
+constexpr bool is_csi_final(char const c)
+{
+    return c >= 0x40 && c <= 0x7e;
+}
+
+constexpr bool is_intermediate(char const c)
+{
+    return c >= 0x20 && c <= 0x2f;
+}
+
+inline void enter_escape(decoder_state& s)
+{
+    s.state = parser_state::escape;
+}
+
+inline void enter_csi(decoder_state& s)
+{
+    s.state = parser_state::csi_entry;
+    s.csi_private = 0;
+    s.csi_intermediate = false;
+    s.csi_has_params = false;
+    s.csi_sub = false;
+    s.csi_param_value = 0;
+    s.csi.clear();
+}
+
+template<class Instructee>
+std::size_t decode_ground(COMMON_PARAMS)
+{
+    while (index != size && s.state == parser_state::ground) {
+        auto const first = static_cast<unsigned char>(bytes[index]);
+
+        if (first >= 0x20 && first < 0x7f) {
+            auto const run_begin = bytes + index;
+            auto const run_end = find_printable_end(run_begin + 1, bytes + size);
+            auto const count = run_end - run_begin;
+
+            t.write_ascii(run_begin, static_cast<int>(count));
+            index += static_cast<std::size_t>(count);
+        } else if (first > 0x7f) {
+            index = decode_utf8(ARGS);
+        } else {
+            ++index;
+            if (!execute(s, t, static_cast<char>(first)))
+                t.write_char(static_cast<code_point>(first));
+        }
+    }
+
+    return index;
+}
+
+// Sets up decoding of the UTF-8 sequence that starts with lead.
+// Returns false if lead can't start a sequence.
+inline bool utf8_lead(unsigned char const lead, code_point& codepoint, int& bytes_left)
+{
+    auto bits_received = int{};
+
+    if ((lead & 0b1110'0000) == 0b1100'0000) {
+        bytes_left = 1;
+        bits_received = 5;
+    } else if ((lead & 0b1111'0000) == 0b1110'0000) {
+        bytes_left = 2;
+        bits_received = 4;
+    } else if ((lead & 0b1111'1000) == 0b1111'0000) {
+        bytes_left = 3;
+        bits_received = 3;
+    } else {
+        return false;
+    }
+
+    codepoint = (std::uint32_t{lead} & 0xff >> (8 - bits_received)) << bytes_left * 6;
+    return true;
+}
+
+inline void utf8_continue(code_point& codepoint, int& bytes_left, char const part)
+{
+    auto const utf8_part = static_cast<std::uint32_t>(
+                            static_cast<unsigned char>(part));
+
+    bytes_left -= 1;
+    codepoint |= (utf8_part & 0b0011'1111) << bytes_left * 6;
+}
+
+template<class Instructee>
+std::size_t decode_utf8(COMMON_PARAMS)
+{
+    code_point run[max_utf8_run];
+    auto run_size = 0;
+
+    // Text in non-Latin scripts is mostly multi-byte sequences back to back,
+    // collect them so that they can be written in one batch.
+    while (run_size != max_utf8_run && index != size) {
+        auto const lead = static_cast<unsigned char>(bytes[index]);
+        if (lead <= 0x7f)
+            break;
+
+        ++index;
+
+        auto codepoint = code_point{};
+        auto bytes_left = int{};
+        if (!utf8_lead(lead, codepoint, bytes_left)) {
+            run[run_size++] = replacement_character;
+            continue;
+        }
+
+        while (bytes_left != 0 && index != size)
+            utf8_continue(codepoint, bytes_left, bytes[index++]);
+
+        if (bytes_left != 0) {
+            // Sequence continues in the next decode call
+            s.state = parser_state::utf8;
+            s.utf8_code = codepoint;
+            s.utf8_bytes_left = bytes_left;
+            break;
+        }
+
+        run[run_size++] = codepoint;
+    }
+
+    if (run_size != 0)
+        t.write_chars(run, run_size);
+
+    return index;
+}
+
+template<class Instructee>
+std::size_t decode_utf8_continuation(COMMON_PARAMS)
+{
+    while (s.utf8_bytes_left != 0 && index != size)
+        utf8_continue(s.utf8_code, s.utf8_bytes_left, bytes[index++]);
+
+    if (s.utf8_bytes_left == 0) {
+        s.state = parser_state::ground;
+        t.write_char(s.utf8_code);
+    }
+
+    return index;
+}
+
+// Handles the C0 control characters, these can also appear in the middle of
+// escape sequences.
+// Returns false for control characters that aren't handled.
+template<class Instructee>
+bool execute(decoder_state& s, Instructee& t, char const c)
+{
+    switch(c) {
+        case '\t':
+            t.tab();
+            return true;
+
+        case '\f':
+        case '\v':
+        case '\n':
+            t.line_feed(false);
+            return true;
+
+        case '\r':
+            t.carriage_return();
+            return true;
+
+        case '\b':
+            t.backspace();
+            return true;
+
+        case '\a':
+            return true;
+
+        case '\016': /* SO (LS1 -- Locking shift 1) */
+        case '\017': /* SI (LS0 -- Locking shift 0) */
+            t.use_charset_table(c - '\016');
+            return true;
+
+        case esc:
+            enter_escape(s);
+            return true;
+
+        case can:
+        case sub:
+            s.state = parser_state::ground;
+            return true;
+    }
+
+    return false;
+}
+
+template<class Instructee>
+std::size_t decode_sequence(COMMON_PARAMS)
+{
+    while (index != size) {
+        auto const c = bytes[index++];
+
+        // Control characters are executed without interrupting the sequence
+        if (static_cast<unsigned char>(c) < 0x20) {
+            execute(s, t, c);
+        } else if (c == '\x7f') {
+            // ignored
+        } else {
+            switch(s.state) {
+                case parser_state::escape:
+                    decode_escape(s, t, c);
+                    break;
+
+                case parser_state::escape_intermediate:
+                    if (!is_intermediate(c))
+                        s.state = parser_state::ground;
+                    break;
+
+                case parser_state::charset:
+                    decode_set_charset_table(s, t, c);
+                    break;
+
+                default:
+                    decode_csi(s, t, c);
+                    break;
+            }
+        }
+
+        switch(s.state) {
+            case parser_state::ground:
+            case parser_state::control_string:
+            case parser_state::control_string_overflow:
+                return index;
+
+            default:
+                break;
+        }
+    }
+
+    return index;
+}
+
+template<class Instructee>
+void decode_escape(decoder_state& s, Instructee& t, char const code)
+{
+    s.state = parser_state::ground;
+
+    // CSI and control strings are counted separately, ESC \ ends a string.
+    KATERM_COUNT(s.stats.escapes, code != '[' && code != '\\' && code != 'P' &&
+                                  code != ']' && code != 'X' && code != '^' && code != '_');
+
+    switch(code) {
+        case 'n': /* LS2 -- Locking shift 2 */
+        case 'o': /* LS3 -- Locking shift 3 */
+            t.use_charset_table(code - 'n' + 2);
+            break;
+
+        case '\\': // string terminator
+        default:
+            if (is_intermediate(code))
+                s.state = parser_state::escape_intermediate;
+            break;
+
+        case '(':
+        case ')':
+        case '*':
+        case '+':
+            s.state = parser_state::charset;
+            s.charset_table = code - '(';
+            break;
+
+        case 'P' : // device control string
+        case ']' : // operating system command
+        case 'X' : // start of string
+        case '^' : // privacy message
+        case '_' : // application program command
+            s.state = parser_state::control_string;
+            s.string_length = 0;
+            KATERM_COUNT(code == ']' ? s.stats.osc : s.stats.other_strings, 1);
+            break;
+
+        case 'M':
+            t.reverse_line_feed();
+            break;
+
+        case '[':
+            enter_csi(s);
+            break;
+    }
+}
+
+template<class Instructee>
+void decode_set_charset_table(decoder_state& s, Instructee& t, char const c)
+{
+    s.state = parser_state::ground;
+
+    switch(c) {
+        case '0':
+            t.set_charset_table(s.charset_table, charset::graphic0);
+            break;
+
+        case 'B':
+            t.set_charset_table(s.charset_table, charset::usa);
+            break;
+
+        default:
+            break; // discard unknown
+    }
+}
+
+inline std::size_t discard_string(
+        char const* const bytes,
+        std::size_t const size,
+        std::size_t index,
+        decoder_state& s)
+{
+    while (index != size) {
+        switch (bytes[index++]) {
+            case '\a':
+            case can:
+            case sub:
+                s.state = parser_state::ground;
+                return index;
+
+            case esc:
+                // Either the start of the string terminator ESC \ or an
+                // escape sequence that aborts the string.
+                enter_escape(s);
+                return index;
+        }
+    }
+
+    return index;
+}
+
+inline void push_csi_param(decoder_state& s)
+{
+    if (s.csi_sub)
+        s.csi.push_sub(s.csi_param_value);
+    else
+        s.csi.push(s.csi_param_value);
+
+    s.csi_param_value = 0;
+}
+
+template<class Instructee>
+void decode_csi(decoder_state& s, Instructee& t, char const c)
+{
+    if (is_csi_final(c)) {
+        auto const ignored = s.state == parser_state::csi_ignore;
+        s.state = parser_state::ground;
+
+        if (!ignored)
+            dispatch_csi(s, t, c);
+
+        return;
+    }
+
+    if (s.state == parser_state::csi_ignore)
+        return;
+
+    if (is_intermediate(c)) {
+        s.csi_intermediate = true;
+        s.state = parser_state::csi_intermediate;
+        return;
+    }
+
+    // Parameter bytes after an intermediate make the sequence invalid
+    if (s.state == parser_state::csi_intermediate) {
+        s.state = parser_state::csi_ignore;
+        return;
+    }
+
+    if (c >= '0' && c <= '9') {
+        s.csi_param_value = std::min(
+                                s.csi_param_value * 10 + (c - '0'),
+                                max_csi_param_value);
+
+        s.csi_has_params = true;
+        s.state = parser_state::csi_param;
+        return;
+    }
+
+    if (c == ';' || c == ':') {
+        push_csi_param(s);
+        s.csi_sub = c == ':';
+        s.csi_has_params = true;
+        s.state = parser_state::csi_param;
+        return;
+    }
+
+    // Private markers are only allowed right after the CSI
+    if (c >= 0x3c && c <= 0x3f && s.state == parser_state::csi_entry) {
+        s.csi_private = c;
+        s.state = parser_state::csi_param;
+        return;
+    }
+
+    s.state = parser_state::csi_ignore;
+}
+
+template<class Instructee>
+void dispatch_csi(decoder_state& s, Instructee& t, char const final)
+{
+    if (s.csi_has_params)
+        push_csi_param(s);
+
+    if (s.csi_intermediate)
+        return;
+
+    KATERM_COUNT(s.stats.csi, 1);
+    KATERM_COUNT(s.stats.csi_by_final[final - 0x40], 1);
+    KATERM_COUNT(s.stats.sgr_params, final == 'm' && s.csi_private == 0 ? s.csi.size() : 0);
+
+    switch (s.csi_private) {
+        case 0:
+            decode_csi_pub(t, s.csi, final);
+            break;
+
+        case '?':
+            decode_csi_priv(t, s.csi, final);
+            break;
+
+        default:
+            t.unhandled_csi(s.csi_private, final, s.csi);
+            break;
+    }
+}
+
+template<class Instructee>
+void decode_csi_priv(
+        Instructee& t,
+        csi_params const& params,
+        char const final)
+{
+    switch (final) {
+        case 'l':
+        case 'h':
+            decode_private_set(t, params, final == 'h');
+            break;
+
+        default:
+            t.unhandled_csi('?', final, params);
+            break;
+    }
+}
+
+template<class Instructee>
+void decode_csi_pub(
+        Instructee& t,
+        csi_params const& params,
+        char const final)
+{
+    switch(final) {
+        default:
+            t.unhandled_csi(0, final, params);
+            break;
+
+        case 'J': {
+            switch(params.get(0)) {
+                case 0:
+                    t.clear_to_bottom();
+                    break;
+                case 1:
+                    t.clear_from_top();
+                    break;
+
+                case 2:
+                default:
+                    t.clear_screen();
+                    break;
+            }
+        } break;
+
+        case 'G':
+        case '`':
+            t.move_to_column(params.get(0, 1) - 1);
+            break;
+
+        case 'd':
+            t.move_to_row(params.get(0, 1) - 1);
+            break;
+
+        case 'f':
+        case 'H':
+            t.position_cursor({
+                std::max(0, params.get(1) - 1),
+                std::max(0, params.get(0) - 1)
+            });
+            break;
+
+        case 'K': {
+            switch(params.get(0)) {
+                case 0:
+                    t.clear_to_end();
+                    break;
+
+                case 1:
+                    t.clear_from_begin();
+                    break;
+
+                case 2:
+                default:
+                    t.clear_line();
+                    break;
+
+            }
+        } break;
+
+        case 'l':
+        case 'h':
+            decode_public_set(t, params, final == 'h');
+            break;
+
+        case 'A':
+            t.move_cursor(params.get(0, 1), direction::up, false);
+            break;
+
+        case 'B':
+        case 'e':
+            t.move_cursor(params.get(0, 1), direction::down, false);
+            break;
+
+        case 'C':
+        case 'a':
+            t.move_cursor(params.get(0, 1), direction::forward, false);
+            break;
+
+        case 'D':
+            t.move_cursor(params.get(0, 1), direction::back, false);
+            break;
+
+        case 'E':
+            t.move_cursor(params.get(0, 1), direction::down, true);
+            break;
+
+        case 'F':
+            t.move_cursor(params.get(0, 1), direction::up, true);
+            break;
+
+        case 'P':
+            t.delete_chars(params.get(0, 1));
+            break;
+
+        case 'X':
+            t.erase_chars(params.get(0, 1));
+            break;
+
+        case 'M':
+            t.delete_lines(params.get(0, 1));
+            break;
+
+        case '@':
+            t.insert_blanks(params.get(0, 1));
+            break;
+
+        case 'L':
+            t.insert_newline(params.get(0, 1));
+            break;
+
+        case 'r': // DECSTBM, the 1-based bottom is an exclusive 0-based one
+            t.set_scroll_region(params.get(0, 1) - 1, params.get(1));
+            break;
+
+        case 'm':
+            decode_set_graphics(t, params);
+            break;
+    }
+}
+
+template<class Instructee>
+void decode_private_set(
+        Instructee& t,
+        csi_params const& params,
+        bool const set)
+{
+    for (int i = 0; i != params.size(); ++i) {
+        switch(params.get(i)) {
+            case 9:
+                t.set_mouse_mode(mouse_mode::x10, set);
+                break;
+
+            case 1000:
+                t.set_mouse_mode(mouse_mode::button, set);
+                break;
+
+            case 1002:
+                t.set_mouse_mode(mouse_mode::motion, set);
+                break;
+
+            case 1003:
+                t.set_mouse_mode(mouse_mode::many, set);
+                break;
+
+            case 1006:
+                t.set_mouse_mode_extended(set);
+                break;
+
+            case 2004:
+                t.set_bracketed_paste(set);
+        }
+    }
+}
+
+template<class Instructee>
+void decode_public_set(
+        Instructee& t,
+        csi_params const& params,
+        bool const set)
+{
+    terminal_mode mode;
+    for (int i = 0; i != params.size(); ++i) {
+        switch(params.get(i)) {
+            case 4:
+                mode.set(terminal_mode_bit::insert);
+        }
+    }
+
+    t.change_mode_bits(set, mode);
+}
+
+inline colour rgb_colour(int const r, int const g, int const b)
+{
+    return colour{
+        static_cast<std::uint8_t>(std::clamp(r, 0, 255)),
+        static_cast<std::uint8_t>(std::clamp(g, 0, 255)),
+        static_cast<std::uint8_t>(std::clamp(b, 0, 255)),
+    };
+}
+
+template<class Instructee>
+void decode_set_graphics(Instructee& t, csi_params const& params)
+{
+    for(int i{}; i == 0 || i < params.size(); ++i) {
+        auto num = params.get(i);
+        switch(num) {
+            case 0:
+                t.reset_style();
+                break;
+
+            case 1:
+                t.set_bold(true);
+                break;
+
+            case 22:
+                t.set_bold(false);
+                break;
+
+            case 7:
+                t.set_reversed(true);
+                break;
+
+            case 27:
+                t.set_reversed(false);
+                break;
+
+            case 38:
+            case 48: {
+                auto is_foreground = num == 38;
+                auto col = colour{};
+
+                if (params.sub_count(i) != 0) {
+                    // 38:5:n or 38:2:[colour space]:r:g:b, the colour space
+                    // id is left out by most programs.
+                    auto const rgb = params.sub_count(i) >= 5 ? 2 : 1;
+                    switch (params.get_sub(i, 0)) {
+                        case 5:
+                            col = eight_bit_lookup(params.get_sub(i, 1));
+                            break;
+
+                        case 2:
+                            col = rgb_colour(
+                                params.get_sub(i, rgb),
+                                params.get_sub(i, rgb + 1),
+                                params.get_sub(i, rgb + 2));
+                            break;
+
+                        default:
+                            continue;
+                    }
+                } else {
+                    switch (params.get(i + 1)) {
+                        case 5:
+                            col = eight_bit_lookup(params.get(i + 2));
+                            i += 2;
+                            break;
+
+                        case 2:
+                            col = rgb_colour(
+                                params.get(i + 2),
+                                params.get(i + 3),
+                                params.get(i + 4));
+                            i += 4;
+                            break;
+
+                        default:
+                            return;
+                    }
+                }
+
+                if (is_foreground) t.set_foreground(col);
+                else               t.set_background(col);
+            } break;
+
+            case 39:
+                t.default_foreground();
+                break;
+
+            case 49:
+                t.default_background();
+                break;
+
+            default:
+                if (num >= 30 && num <= 37)
+                    t.set_foreground(sgr_colours[num - 30]);
+                if (num >= 90 && num <= 97)
+                    t.set_foreground(sgr_colours[num - 90 + 8]);
+                if (num >= 40 && num <= 47)
+                    t.set_background(sgr_colours[num - 40]);
+                if (num >= 100 && num <= 107)
+                    t.set_background(sgr_colours[num - 100 + 8]);
+        }
+    }
+}
+
+} // detail::
+
+template<class Instructee>
+void basic_decoder<Instructee>::decode(
+        char const* const bytes,
+        int const count,
+        Instructee& t)
+{
+    auto const size = static_cast<std::size_t>(count);
+    auto index = std::size_t{0};
+    auto& s = state;
+
+    KATERM_COUNT(s.stats.bytes, size);
+    KATERM_COUNT(s.stats.decode_calls, 1);
+
+    while (index != size) {
+        switch (s.state) {
+            case parser_state::ground:
+                index = detail::decode_ground(ARGS);
+                break;
+
+            case parser_state::utf8:
+                index = detail::decode_utf8_continuation(ARGS);
+                break;
+
+            case parser_state::control_string: {
+                auto const start = index;
+                index = detail::discard_string(bytes, size, index, s);
+
+                // Length includes the terminator, that doesn't matter much.
+                s.string_length += index - start;
+                KATERM_COUNT(s.stats.string_bytes, index - start);
+                if (s.string_length > max_string_length) {
+                    ++overlong_strings;
+                    if (s.state == parser_state::control_string)
+                        s.state = parser_state::control_string_overflow;
+                }
+            } break;
+
+            case parser_state::control_string_overflow: {
+                [[maybe_unused]] auto const start = index;
+                index = detail::discard_string(bytes, size, index, s);
+                KATERM_COUNT(s.stats.string_bytes, index - start);
+            } break;
+
+            default:
+                index = detail::decode_sequence(ARGS);
+                break;
+        }
+    }
+
+    KATERM_COUNT(s.stats.split_sequences, s.state != parser_state::ground);
+}
+
+template<class Instructee>
+void basic_decoder<Instructee>::set_max_string_length(std::size_t const length)
+{
+    max_string_length = length;
+}
+
+template<class Instructee>
+std::size_t basic_decoder<Instructee>::overlong_string_count() const
+{
+    return overlong_strings;
+}
+
+template<class Instructee>
+decoder_stats const& basic_decoder<Instructee>::stats() const
+{
+    return state.stats;
+}
+
+#undef COMMON_PARAMS
+#undef ARGS
+
+} // katerm::
+
+#endif // header guard
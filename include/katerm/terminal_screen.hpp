@@ -4,24 +4,55 @@
 #include <vector>
 #include <memory>
 
+#include "cluster_table.hpp"
 #include "glyph.hpp"
+#include "scrollback.hpp"
+#include "stats.hpp"
 
 namespace katerm {
 
 struct line {
-    glyph* glyphs;
-    bool changed;
+    // At least as many glyphs as the screen is wide
+    std::vector<glyph> glyphs;
+
+    // Columns [dirty_beg, dirty_end) changed since the last clear_changes.
+    int dirty_beg = 0;
+    int dirty_end = 0;
+
+    // Glyphs from used to the end of the line are all fill, they aren't
+    // necessarily written to storage.
+    int used = 0;
+    glyph fill = {};
+};
+
+// Lines [top, bottom) moved up by count since the last clear_changes, down for
+// a negative count. Lines that didn't change since are still the same.
+struct scroll_change {
+    int top = 0;
+    int bottom = 0;
+    int count = 0;
 };
 
+// The lines are kept in a ring buffer: logical line y is stored in
+// lines[(m_head + y) % height], so scrolling the whole screen only has to move
+// m_head and clear the lines that come into view.
 class terminal_screen {
 private:
     extend m_size;
-    int m_scroll = 0;
+    scroll_change m_scroll;
+    int m_head = 0;
 
-public:
-    std::vector<glyph> data;
     std::vector<line> lines;
 
+    scrollback m_history;
+
+    // Shared with copies of the screen and with frames, copied before adding
+    // a cluster when it is.
+    std::shared_ptr<cluster_table> m_clusters;
+
+    screen_stats m_stats;
+
+public:
     terminal_screen()
         : terminal_screen({80, 25})
     {
@@ -29,31 +60,103 @@ public:
 
     terminal_screen(extend screen_sz);
 
+    // Resizes in place, lines keep their glyphs up to the new width and only
+    // lines that are new are marked dirty.
     int resize(extend new_size, int preserve_column, glyph fill_glyph);
     void resize(extend new_size);
 
+    // Resizes and re-wraps soft wrapped lines, including the scrollback, at
+    // the new width. Returns where the glyph at cursor ended up.
+    position reflow(extend new_size, position cursor);
+
+    // Whether reflowing to new_width could move any glyph, false when no
+    // line soft wraps and all of them fit. Resizing in place does the same
+    // then without going through the scrollback.
+    bool needs_reflow(int new_width) const;
+
     void fill_lines(int line_beg, int line_end, glyph fill_glyph);
 
+    // Moves lines [top, bottom) by count, the lines that come in are set to
+    // fill. Lines scrolled off the top of the screen are added to the
+    // history, also when the region ends above the bottom like in xterm.
+    void scroll_up(int top, int bottom, int count, glyph fill);
+    void scroll_down(int top, int bottom, int count, glyph fill);
+
+    // Like scroll_up but the lines are dropped, deleted lines never go to
+    // the history.
+    void delete_lines(int top, int bottom, int count, glyph fill);
+
+    // Scrolls lines [keep_top, height)
     void scroll_up(int keep_top, int const count, glyph fill);
     void scroll_down(int keep_top, int const count, glyph fill);
 
+    // Lines scrolled off the top of the screen end up here
+    scrollback& history();
+    scrollback const& history() const;
+
+    // Clusters referenced by glyphs with glyph_attr_bit::cluster, on the
+    // screen and in the history.
+    cluster_table const& clusters() const;
+    std::shared_ptr<cluster_table const> shared_clusters() const;
+    cluster_table::id_type intern_cluster(code_point const* code_points, int count);
+
+    // Writable lines and glyphs, these store the unused part they cover.
     glyph* get_line(int line);
     glyph& get_glyph(position pos);
 
-    glyph const* get_line(int line) const;
+    // Like get_line but only [0, end) is guaranteed to be stored.
+    glyph* edit_line(int line, int end);
+
+    // Sets [x, width) of the line to fill, x = 0 clears it in O(1).
+    void clear_line_from(int line, int x, glyph fill);
+
+    // Only the first line_length(line) glyphs are stored, the glyphs after
+    // them are stale and the rest of the line is line_fill(line).
+    glyph const* stored_glyphs(int line) const;
     glyph const& get_glyph(position pos) const;
+    int line_length(int line) const;
+    glyph const& line_fill(int line) const;
 
     extend size() const;
+
+    // Marks all columns of lines [start, end) dirty.
     void mark_dirty(int start, int end);
 
-    // Retrieve how much the scrolling has changed +/-
-    int changed_scroll() const;
+    // Marks columns [x_beg, x_end) of the line dirty.
+    void mark_dirty_columns(int line, int x_beg, int x_end);
+
+    // Whether the line changed since the last clear_changes
+    bool line_changed(int line) const;
+
+    // The columns of the line that changed, empty if it didn't change.
+    rect line_damage(int line) const;
+
+    // Changed areas since the last clear_changes, top to bottom. Consecutive
+    // lines that changed in the same columns are merged into one rect.
+    std::vector<rect> damage() const;
+
+    // Whether any line or the scroll changed since the last clear_changes
+    bool has_changes() const;
+
+    // Only one scrolled region is tracked. Scrolling a different one marks
+    // the lines of the earlier region dirty instead.
+    scroll_change changed_scroll() const;
 
     void clear_changes();
-    void move_scroll(int change);
+
+    // Counters since construction, all 0 without KATERM_STATS.
+    screen_stats const& stats() const;
 
 private:
-    void set_scroll(int scroll);
+    void add_scroll(int top, int bottom, int count);
+
+    line& line_info(int line);
+    line const& line_info(int line) const;
+
+    // std::rotate and std::reverse on the logical lines [first, last).
+    // Lines past the bottom wrap around to the top of the screen.
+    void rotate_lines(int first, int middle, int last);
+    void reverse_lines(int first, int last);
 };
 
 } // katerm::
@@ -0,0 +1,52 @@
+#ifndef KATERM_UPDATE_SCHEDULER_HPP
+#define KATERM_UPDATE_SCHEDULER_HPP
+
+#include <chrono>
+#include <functional>
+
+#include "terminal_screen.hpp"
+
+namespace katerm {
+
+// Decides when a changed screen should be drawn.
+//
+// Changes after the screen has been quiet for min_interval are reported right
+// away, so echoing typed characters isn't delayed. Changes that come in
+// faster than that are coalesced and reported once min_interval after the
+// previous report, so a flood of output is drawn at a fixed rate instead of
+// after every decode call.
+//
+// The scheduler doesn't own a timer. Call poll after decoding and again once
+// deadline() has passed.
+class update_scheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr auto default_min_interval = std::chrono::microseconds{16'667};
+
+private:
+    clock::duration m_min_interval;
+    clock::time_point m_last_frame = clock::time_point::min();
+    bool m_pending = false;
+
+    std::function<void()> m_frame_ready;
+
+public:
+    explicit update_scheduler(clock::duration min_interval = default_min_interval);
+
+    // Called from poll when a frame should be drawn. Drawing is expected to
+    // consume the screen's changes, through snapshot or clear_changes.
+    void on_frame_ready(std::function<void()> callback);
+
+    void set_min_interval(clock::duration min_interval);
+    clock::duration min_interval() const;
+
+    void poll(terminal_screen const& screen, clock::time_point now);
+
+    // When held changes are due, clock::time_point::max() when there are none.
+    clock::time_point deadline() const;
+};
+
+} // katerm::
+
+#endif // header guard
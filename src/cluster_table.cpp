@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include <katerm/cluster_table.hpp>
+
+namespace katerm {
+
+namespace {
+
+std::size_t hash_code_points(code_point const* const code_points, int const count)
+{
+    // 64 bit FNV-1a, also where size_t has 32 bits
+    auto hash = std::uint64_t{14695981039346656037ull};
+    for (int i = 0; i != count; ++i) {
+        hash ^= code_points[i];
+        hash *= 1099511628211ull;
+    }
+
+    return static_cast<std::size_t>(hash);
+}
+
+} // anonymous namespace
+
+cluster_table::cluster_table()
+    : m_offsets{0, 0} // Id 0 is an empty placeholder
+{
+}
+
+cluster_table::id_type cluster_table::find(code_point const* const code_points, int count) const
+{
+    count = std::min(count, max_cluster_length);
+
+    auto const [first, last] = m_lookup.equal_range(hash_code_points(code_points, count));
+    for (auto it = first; it != last; ++it) {
+        auto const existing = get(it->second);
+        if (std::equal(
+                existing.code_points, existing.code_points + existing.count,
+                code_points, code_points + count))
+        {
+            return it->second;
+        }
+    }
+
+    return 0;
+}
+
+cluster_table::id_type cluster_table::intern(code_point const* const code_points, int count)
+{
+    count = std::min(count, max_cluster_length);
+
+    if (auto const existing = find(code_points, count))
+        return existing;
+
+    auto const hash = hash_code_points(code_points, count);
+
+    if (size() == max_clusters)
+        return 0;
+
+    auto const id = static_cast<id_type>(m_offsets.size() - 1);
+    m_code_points.insert(m_code_points.end(), code_points, code_points + count);
+    m_offsets.push_back(static_cast<std::uint32_t>(m_code_points.size()));
+    m_lookup.emplace(hash, id);
+    return id;
+}
+
+cluster_table::cluster cluster_table::get(id_type const id) const
+{
+    auto const begin = m_offsets[id];
+    auto const end = m_offsets[id + 1];
+    return {m_code_points.data() + begin, static_cast<int>(end - begin)};
+}
+
+std::size_t cluster_table::size() const
+{
+    return m_offsets.size() - 2;
+}
+
+} // katerm::
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include <katerm/compact_screen.hpp>
+
+namespace katerm {
+
+compact_screen::compact_screen(extend const screen_sz)
+    : m_size{screen_sz}
+    , cells(static_cast<std::size_t>(m_size.width * m_size.height))
+{
+    if (cells.empty())
+        return;
+
+    // Packing into an empty palette can't fail. Every cell holds a reference
+    // to the blank colours.
+    auto blank = packed_glyph{};
+    packed_glyph::pack(glyph{}, m_palette, blank);
+    m_palette.retain(blank.fg_index(), cells.size() - 1);
+    m_palette.retain(blank.bg_index(), cells.size() - 1);
+    std::fill(cells.begin(), cells.end(), blank);
+}
+
+compact_screen::compact_screen(terminal_screen const& screen)
+    : compact_screen{screen.size()}
+{
+    for (auto y = 0; y != m_size.height; ++y) {
+        auto const* const line = screen.stored_glyphs(y);
+        auto const used = screen.line_length(y);
+        auto const& fill = screen.line_fill(y);
+
+        for (auto x = 0; x != m_size.width; ++x)
+            store(y * m_size.width + x, x < used ? line[x] : fill);
+    }
+}
+
+glyph compact_screen::get_glyph(position const pos) const
+{
+    auto const cell = static_cast<std::size_t>(pos.y * m_size.width + pos.x);
+    if (cells[cell].fg_index() == colour_palette::no_index)
+        return m_overflow.at(cell);
+
+    return cells[cell].unpack(m_palette);
+}
+
+void compact_screen::set_glyph(position const pos, glyph const& g)
+{
+    store(pos.y * m_size.width + pos.x, g);
+}
+
+void compact_screen::copy_to(terminal_screen& screen) const
+{
+    for (auto y = 0; y != m_size.height; ++y) {
+        auto* const line = screen.get_line(y);
+        for (auto x = 0; x != m_size.width; ++x)
+            line[x] = get_glyph({x, y});
+    }
+
+    screen.mark_dirty(0, m_size.height);
+}
+
+extend compact_screen::size() const
+{
+    return m_size;
+}
+
+colour_palette const& compact_screen::palette() const
+{
+    return m_palette;
+}
+
+void compact_screen::store(std::size_t const cell, glyph const& g)
+{
+    auto& packed = cells[cell];
+    if (packed.fg_index() == colour_palette::no_index) {
+        m_overflow.erase(cell);
+    } else {
+        m_palette.release(packed.fg_index());
+        m_palette.release(packed.bg_index());
+    }
+
+    if (!packed_glyph::pack(g, m_palette, packed)) {
+        packed = packed_glyph{
+            g.code, g.style.mode, colour_palette::no_index, colour_palette::no_index};
+        m_overflow[cell] = g;
+    }
+}
+
+} // katerm::
@@ -0,0 +1,139 @@
+#include <algorithm>
+
+#include <katerm/frame.hpp>
+
+namespace katerm {
+
+static_assert(std::is_copy_assignable_v<frame>);
+
+extend frame::size() const
+{
+    return m_size;
+}
+
+terminal_cursor const& frame::cursor() const
+{
+    return m_cursor;
+}
+
+terminal_mode frame::mode() const
+{
+    return m_mode;
+}
+
+glyph const& frame::get_glyph(position const pos) const
+{
+    auto const& info = *m_lines[pos.y];
+    if (pos.x >= static_cast<int>(info.glyphs.size()))
+        return info.fill;
+
+    return info.glyphs[pos.x];
+}
+
+cluster_table const& frame::clusters() const
+{
+    static auto const empty = cluster_table{};
+    return m_clusters ? *m_clusters : empty;
+}
+
+glyph const* frame::get_line(int const line) const
+{
+    return m_lines[line]->glyphs.data();
+}
+
+int frame::line_length(int const line) const
+{
+    return static_cast<int>(m_lines[line]->glyphs.size());
+}
+
+glyph const& frame::line_fill(int const line) const
+{
+    return m_lines[line]->fill;
+}
+
+frame snapshot(terminal& term, frame const& previous)
+{
+    auto& screen = term.screen;
+    auto const size = screen.size();
+    auto const height = size.height;
+
+    auto result = frame{};
+    result.m_size = size;
+    result.m_cursor = term.cursor;
+    result.m_mode = term.mode;
+    result.m_lines.resize(height);
+    result.m_clusters = screen.shared_clusters();
+
+    // Old lines can only be reused when they have the same width, the height
+    // changing resets the scroll so that needs a full copy too.
+    auto const reuse = previous.m_size == size;
+
+    auto const change = reuse ? screen.changed_scroll() : scroll_change{};
+
+    result.m_sequence = previous.m_sequence + 1;
+    result.m_scrolled = previous.m_scrolled + change.count;
+    result.m_scroll_top = previous.m_scroll_top;
+    result.m_scroll_bottom = previous.m_scroll_bottom;
+    result.m_region_since = previous.m_region_since;
+
+    if (change.count != 0
+            && (change.top != previous.m_scroll_top || change.bottom != previous.m_scroll_bottom)) {
+        result.m_scroll_top = change.top;
+        result.m_scroll_bottom = change.bottom;
+        result.m_region_since = result.m_sequence;
+    }
+
+    for (auto y = 0; y != height; ++y) {
+        auto const in_region = y >= change.top && y < change.bottom;
+        auto const old_y = in_region ? y + change.count : y;
+        if (reuse && !screen.line_changed(y) && old_y >= 0 && old_y < height) {
+            result.m_lines[y] = previous.m_lines[old_y];
+            continue;
+        }
+
+        auto const* const glyphs = screen.stored_glyphs(y);
+        result.m_lines[y] = std::make_shared<frame::frame_line const>(frame::frame_line{
+            std::vector<glyph>(glyphs, glyphs + std::min(screen.line_length(y), size.width)),
+            screen.line_fill(y)});
+    }
+
+    screen.clear_changes();
+    return result;
+}
+
+frame_diff diff(frame const& from, frame const& to)
+{
+    auto result = frame_diff{};
+    auto const height = to.m_size.height;
+
+    // The scroll can only be replayed when every frame after from scrolled
+    // the same region.
+    auto scroll = to.m_scrolled - from.m_scrolled;
+    auto const region_height = to.m_scroll_bottom - to.m_scroll_top;
+    if (from.m_size != to.m_size || to.m_region_since > from.m_sequence + 1
+            || scroll <= -region_height || scroll >= region_height)
+    {
+        scroll = 0;
+    }
+
+    result.scroll = static_cast<int>(scroll);
+    if (scroll != 0) {
+        result.scroll_top = to.m_scroll_top;
+        result.scroll_bottom = to.m_scroll_bottom;
+    }
+
+    for (auto y = 0; y != height; ++y) {
+        auto const in_region = y >= result.scroll_top && y < result.scroll_bottom;
+        auto const old_y = in_region ? y + result.scroll : y;
+        auto const same = from.m_size == to.m_size
+            && (!in_region || (old_y >= result.scroll_top && old_y < result.scroll_bottom))
+            && from.m_lines[old_y] == to.m_lines[y];
+
+        if (!same)
+            result.lines.push_back(y);
+    }
+
+    return result;
+}
+
+} // katerm::
@@ -0,0 +1,92 @@
+#include <katerm/packed_glyph.hpp>
+
+namespace katerm {
+
+colour_palette::index_type colour_palette::intern(colour const c)
+{
+    auto const key = to_u32(c);
+    auto const it = lookup.find(key);
+    if (it != lookup.end()) {
+        ++references[it->second];
+        return it->second;
+    }
+
+    auto index = index_type{};
+    if (!free_indices.empty()) {
+        index = free_indices.back();
+        free_indices.pop_back();
+        colours[index] = c;
+    } else if (colours.size() != max_colours) {
+        index = static_cast<index_type>(colours.size());
+        colours.push_back(c);
+        references.push_back(0);
+    } else {
+        return no_index;
+    }
+
+    references[index] = 1;
+    lookup.emplace(key, index);
+    return index;
+}
+
+void colour_palette::retain(index_type const index, std::size_t const count)
+{
+    references[index] += static_cast<std::uint32_t>(count);
+}
+
+void colour_palette::release(index_type const index)
+{
+    if (--references[index] != 0)
+        return;
+
+    lookup.erase(to_u32(colours[index]));
+    free_indices.push_back(index);
+}
+
+colour colour_palette::get(index_type const index) const
+{
+    return colours[index];
+}
+
+std::size_t colour_palette::size() const
+{
+    return colours.size() - free_indices.size();
+}
+
+std::size_t colour_palette::memory_usage() const
+{
+    // A node of the lookup table holds the pair and a next pointer.
+    constexpr auto node_size = sizeof(void*) + sizeof(std::pair<std::uint32_t, index_type>);
+
+    return colours.capacity() * sizeof(colour)
+         + references.capacity() * sizeof(std::uint32_t)
+         + free_indices.capacity() * sizeof(index_type)
+         + lookup.bucket_count() * sizeof(void*)
+         + lookup.size() * node_size;
+}
+
+bool packed_glyph::pack(glyph const& g, colour_palette& palette, packed_glyph& out)
+{
+    auto const fg = palette.intern(g.style.fg);
+    if (fg == colour_palette::no_index)
+        return false;
+
+    auto const bg = palette.intern(g.style.bg);
+    if (bg == colour_palette::no_index) {
+        palette.release(fg);
+        return false;
+    }
+
+    out = packed_glyph{g.code, g.style.mode, fg, bg};
+    return true;
+}
+
+glyph packed_glyph::unpack(colour_palette const& palette) const
+{
+    return {
+        glyph_style{palette.get(fg), palette.get(bg), mode()},
+        code()
+    };
+}
+
+} // katerm::
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstring>
+
+#include <katerm/pipeline.hpp>
+
+namespace katerm {
+
+namespace {
+
+std::size_t round_up_pow2(std::size_t const n)
+{
+    auto result = std::size_t{1};
+    while (result < n)
+        result <<= 1;
+
+    return result;
+}
+
+} // anonymous namespace
+
+byte_ring::byte_ring(std::size_t const capacity)
+    : m_capacity{round_up_pow2(capacity)}
+    , m_data{new char[m_capacity]}
+{
+}
+
+std::size_t byte_ring::write(char const* const bytes, std::size_t const count)
+{
+    auto const written = m_written.load(std::memory_order_relaxed);
+    auto const read = m_read.load(std::memory_order_acquire);
+
+    auto const amount = std::min(count, m_capacity - (written - read));
+    auto const offset = written & (m_capacity - 1);
+    auto const first = std::min(amount, m_capacity - offset);
+
+    std::memcpy(m_data.get() + offset, bytes, first);
+    std::memcpy(m_data.get(), bytes + first, amount - first);
+
+    m_written.store(written + amount, std::memory_order_release);
+    return amount;
+}
+
+std::size_t byte_ring::peek(char const*& bytes) const
+{
+    auto const read = m_read.load(std::memory_order_relaxed);
+    auto const written = m_written.load(std::memory_order_acquire);
+
+    auto const offset = read & (m_capacity - 1);
+    bytes = m_data.get() + offset;
+    return std::min(written - read, m_capacity - offset);
+}
+
+void byte_ring::consume(std::size_t const count)
+{
+    auto const read = m_read.load(std::memory_order_relaxed);
+    m_read.store(read + count, std::memory_order_release);
+}
+
+std::size_t byte_ring::capacity() const
+{
+    return m_capacity;
+}
+
+void frame_mailbox::publish(frame f)
+{
+    m_slots[m_back] = std::move(f);
+    auto const old = m_middle.exchange(m_back | fresh_bit, std::memory_order_acq_rel);
+    m_back = old & index_mask;
+}
+
+bool frame_mailbox::update()
+{
+    if (!(m_middle.load(std::memory_order_relaxed) & fresh_bit))
+        return false;
+
+    auto const old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = old & index_mask;
+    return true;
+}
+
+frame const& frame_mailbox::current() const
+{
+    return m_slots[m_front];
+}
+
+terminal_pipeline::terminal_pipeline(
+        extend const screen_size,
+        std::size_t const buffer_size)
+    : m_input{buffer_size}
+    , m_term{screen_size}
+{
+}
+
+std::size_t terminal_pipeline::feed(char const* const bytes, std::size_t const count)
+{
+    return m_input.write(bytes, count);
+}
+
+std::size_t terminal_pipeline::process()
+{
+    auto instructee = terminal_instructee{&m_term};
+    auto total = std::size_t{};
+
+    // Publish after a ring's worth, a reader that keeps the ring full would
+    // otherwise keep the renderer waiting.
+    char const* bytes;
+    while (auto const count = m_input.peek(bytes)) {
+        m_decoder.decode(bytes, static_cast<int>(count), instructee);
+        m_input.consume(count);
+        total += count;
+
+        if (total >= m_input.capacity())
+            break;
+    }
+
+    if (total != 0)
+        publish();
+
+    return total;
+}
+
+terminal& terminal_pipeline::term()
+{
+    return m_term;
+}
+
+void terminal_pipeline::publish()
+{
+    m_last = snapshot(m_term, m_last);
+    m_frames.publish(m_last);
+}
+
+bool terminal_pipeline::update()
+{
+    return m_frames.update();
+}
+
+frame const& terminal_pipeline::current() const
+{
+    return m_frames.current();
+}
+
+} // katerm::
@@ -9,4 +9,10 @@ std::ostream& operator<<(std::ostream& os, position const p)
     return os << '(' << p.x << "; " << p.y << ')';
 }
 
+std::ostream& operator<<(std::ostream& os, rect const r)
+{
+    return os << '[' << r.x_beg << ", " << r.x_end << ") x ["
+              << r.y_beg << ", " << r.y_end << ')';
+}
+
 } // katerm::
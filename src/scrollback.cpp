@@ -0,0 +1,440 @@
+#include <algorithm>
+
+#include <katerm/scrollback.hpp>
+#include <katerm/terminal_data.hpp>
+
+namespace katerm {
+
+namespace {
+
+// Not using capacity() because copies of a vector don't keep it.
+std::size_t chunk_capacity(std::vector<packed_glyph> const& glyphs)
+{
+    return std::max(scrollback::chunk_glyphs, glyphs.size());
+}
+
+constexpr auto default_fg_bg = glyph_style{};
+
+std::size_t chunk_bytes(std::vector<packed_glyph> const& glyphs, std::size_t const palette_bytes)
+{
+    return chunk_capacity(glyphs) * sizeof(packed_glyph) + palette_bytes;
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::uint32_t get_varint(std::uint8_t const*& in)
+{
+    auto value = std::uint32_t{};
+    for (int shift = 0;; shift += 7) {
+        auto const byte = *in++;
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+// Encoded colours are 0xrrggbb xor the default colour, so that the default
+// colours take a single byte. to_u32 adds an alpha byte, that is dropped.
+void put_colour(std::vector<std::uint8_t>& out, colour const c, colour const base)
+{
+    put_varint(out, (to_u32(c) ^ to_u32(base)) >> 8);
+}
+
+colour get_colour(std::uint8_t const*& in, colour const base)
+{
+    auto const value = get_varint(in) ^ to_u32(base) >> 8;
+    return colour{
+        static_cast<std::uint8_t>(value >> 16),
+        static_cast<std::uint8_t>(value >> 8),
+        static_cast<std::uint8_t>(value)};
+}
+
+// Lines are encoded from packed glyphs when a chunk goes cold, comparing
+// palette indices, and from glyphs when they're too long for a palette.
+bool same_style(packed_glyph const a, packed_glyph const b)
+{
+    return a.mode().raw() == b.mode().raw()
+        && a.fg_index() == b.fg_index()
+        && a.bg_index() == b.bg_index();
+}
+
+bool same_style(glyph const& a, glyph const& b)
+{
+    return a.style.mode.raw() == b.style.mode.raw()
+        && to_u32(a.style.fg) == to_u32(b.style.fg)
+        && to_u32(a.style.bg) == to_u32(b.style.bg);
+}
+
+bool same_glyph(packed_glyph const a, packed_glyph const b)
+{
+    return a == b;
+}
+
+bool same_glyph(glyph const& a, glyph const& b)
+{
+    return a.code == b.code && same_style(a, b);
+}
+
+code_point code_of(packed_glyph const g)
+{
+    return g.code();
+}
+
+code_point code_of(glyph const& g)
+{
+    return g.code;
+}
+
+void put_style(
+        std::vector<std::uint8_t>& out,
+        glyph_attribute const mode,
+        colour const fg,
+        colour const bg)
+{
+    put_varint(out, mode.raw());
+    put_colour(out, fg, default_style.fg);
+    put_colour(out, bg, default_style.bg);
+}
+
+void put_style(std::vector<std::uint8_t>& out, packed_glyph const g, colour_palette const& palette)
+{
+    put_style(out, g.mode(), palette.get(g.fg_index()), palette.get(g.bg_index()));
+}
+
+void put_style(std::vector<std::uint8_t>& out, glyph const& g, colour_palette const&)
+{
+    put_style(out, g.style.mode, g.style.fg, g.style.bg);
+}
+
+glyph_style get_style(std::uint8_t const*& in)
+{
+    auto style = glyph_style{};
+    style.mode.set_raw(static_cast<std::uint16_t>(get_varint(in)));
+    style.fg = get_colour(in, default_style.fg);
+    style.bg = get_colour(in, default_style.bg);
+    return style;
+}
+
+// Line layout, all numbers are varints:
+//   repeat count, [repeated glyph: code, style]
+//   style runs up to the repeated tail: length, style, codes...
+// A style is the mode and the fg and bg colours, so cold lines don't depend
+// on a palette. The repeated tail is whatever the line ends with, usually
+// blanks.
+template<class Glyph>
+void encode_line(
+        Glyph const* const glyphs,
+        std::uint32_t const length,
+        colour_palette const& palette,
+        std::vector<std::uint8_t>& out)
+{
+    auto repeat = std::uint32_t{};
+    while (repeat != length && same_glyph(glyphs[length - 1 - repeat], glyphs[length - 1]))
+        ++repeat;
+
+    auto const end = length - repeat;
+
+    put_varint(out, repeat);
+    if (repeat > 0) {
+        put_varint(out, code_of(glyphs[length - 1]));
+        put_style(out, glyphs[length - 1], palette);
+    }
+
+    for (std::uint32_t begin = 0; begin != end;) {
+        auto run_end = begin + 1;
+        while (run_end != end && same_style(glyphs[run_end], glyphs[begin]))
+            ++run_end;
+
+        put_varint(out, run_end - begin);
+        put_style(out, glyphs[begin], palette);
+
+        for (auto i = begin; i != run_end; ++i)
+            put_varint(out, code_of(glyphs[i]));
+
+        begin = run_end;
+    }
+}
+
+// Calls f(x, glyph) for the glyphs [0, end) of an encoded line, the rest of
+// it isn't decoded.
+template<class F>
+void decode_line(
+        std::uint8_t const* in,
+        std::uint32_t const length,
+        std::uint32_t const end,
+        F&& f)
+{
+    auto const repeat = get_varint(in);
+    auto tail = glyph{};
+    if (repeat > 0) {
+        tail.code = get_varint(in);
+        tail.style = get_style(in);
+    }
+
+    auto x = std::uint32_t{};
+    while (x != length - repeat) {
+        auto const run = get_varint(in);
+        auto g = glyph{get_style(in), 0};
+
+        for (auto const run_end = x + run; x != run_end; ++x) {
+            if (x == end)
+                return;
+
+            g.code = get_varint(in);
+            f(x, g);
+        }
+    }
+
+    for (; x != end; ++x)
+        f(x, tail);
+}
+
+} // anonymous namespace
+
+scrollback::scrollback(std::size_t const max_bytes)
+    : max_bytes{max_bytes}
+{
+}
+
+void scrollback::push_line(glyph const* const glyphs, int const count)
+{
+    if (max_bytes == 0)
+        return;
+
+    auto const length = static_cast<std::size_t>(std::max(count, 0));
+
+    // Writing sets text_wraps on the last glyph, or on a wide glyph before
+    // its wdummy.
+    if (length > 0) {
+        auto const* last = glyphs + length - 1;
+        if (length > 1 && last->style.mode.is_set(glyph_attr_bit::wdummy))
+            --last;
+
+        any_wrapped = any_wrapped || last->style.mode.is_set(glyph_attr_bit::text_wraps);
+    }
+
+    longest = std::max(longest, length);
+
+    if (length > max_hot_line)
+        push_cold_line(glyphs, length);
+    else
+        push_hot_line(glyphs, length);
+
+    used_bytes += sizeof(line_ref);
+
+    evict();
+}
+
+void scrollback::push_hot_line(glyph const* const glyphs, std::size_t const length)
+{
+    if (chunks.empty() || chunks.back().cold
+            || chunks.back().glyphs.size() + length > chunk_capacity(chunks.back().glyphs)) {
+        auto const capacity = std::max(chunk_glyphs, length);
+        auto& c = chunks.emplace_back();
+        c.glyphs.reserve(capacity);
+        c.palette_bytes = c.palette.memory_usage();
+        used_bytes += chunk_bytes(c.glyphs, c.palette_bytes);
+
+        if (chunks.size() > hot_chunks)
+            make_cold(chunks.size() - hot_chunks - 1);
+    }
+
+    auto& c = chunks.back();
+    auto const colours = c.palette.size();
+
+    auto const offset = c.glyphs.size();
+    c.glyphs.resize(offset + length);
+    auto* const out = c.glyphs.data() + offset;
+
+    // Neighbouring glyphs almost always share colours, only look up changes.
+    // A chunk holds at most max_hot_line glyphs, so its palette never fills.
+    auto fg = c.palette.intern(default_fg_bg.fg);
+    auto bg = c.palette.intern(default_fg_bg.bg);
+    auto last = default_fg_bg;
+
+    for (std::size_t i = 0; i != length; ++i) {
+        auto const& g = glyphs[i];
+
+        if (to_u32(g.style.fg) != to_u32(last.fg)) {
+            fg = c.palette.intern(g.style.fg);
+            last.fg = g.style.fg;
+        }
+
+        if (to_u32(g.style.bg) != to_u32(last.bg)) {
+            bg = c.palette.intern(g.style.bg);
+            last.bg = g.style.bg;
+        }
+
+        out[i] = packed_glyph{g.code, g.style.mode, fg, bg};
+    }
+
+    if (c.palette.size() != colours) {
+        used_bytes -= c.palette_bytes;
+        c.palette_bytes = c.palette.memory_usage();
+        used_bytes += c.palette_bytes;
+    }
+
+    lines.push_back({
+        first_chunk + chunks.size() - 1,
+        static_cast<std::uint32_t>(offset),
+        static_cast<std::uint32_t>(length)});
+}
+
+void scrollback::push_cold_line(glyph const* const glyphs, std::size_t const length)
+{
+    auto& c = chunks.emplace_back();
+    encode_line(glyphs, static_cast<std::uint32_t>(length), c.palette, c.encoded);
+    c.encoded.shrink_to_fit();
+    c.cold = true;
+    used_bytes += c.encoded.size();
+
+    lines.push_back({
+        first_chunk + chunks.size() - 1,
+        0,
+        static_cast<std::uint32_t>(length)});
+
+    if (chunks.size() > hot_chunks)
+        make_cold(chunks.size() - hot_chunks - 1);
+}
+
+std::size_t scrollback::size() const
+{
+    return lines.size();
+}
+
+int scrollback::line_length(std::size_t const index) const
+{
+    return static_cast<int>(lines[index].length);
+}
+
+glyph scrollback::get_glyph(std::size_t const index, int const x) const
+{
+    auto const& ref = lines[index];
+    auto const& c = chunks[ref.chunk - first_chunk];
+
+    if (!c.cold)
+        return c.glyphs[ref.offset + x].unpack(c.palette);
+
+    // Only decodes up to x, the glyph is the last one decoded.
+    auto result = glyph{};
+    decode_line(c.encoded.data() + ref.offset, ref.length,
+        static_cast<std::uint32_t>(x) + 1,
+        [&](std::uint32_t, glyph const& g) {
+            result = g;
+        });
+
+    return result;
+}
+
+bool scrollback::has_wrapped_lines() const
+{
+    return any_wrapped;
+}
+
+std::size_t scrollback::longest_line() const
+{
+    return longest;
+}
+
+void scrollback::read_line(std::size_t const index, std::vector<glyph>& out) const
+{
+    auto const& ref = lines[index];
+    auto const& c = chunks[ref.chunk - first_chunk];
+
+    if (c.cold) {
+        decode_line(c.encoded.data() + ref.offset, ref.length, ref.length,
+            [&](std::uint32_t, glyph const& g) {
+                out.push_back(g);
+            });
+        return;
+    }
+
+    auto const* const glyphs = c.glyphs.data() + ref.offset;
+    for (std::uint32_t i = 0; i != ref.length; ++i)
+        out.push_back(glyphs[i].unpack(c.palette));
+}
+
+void scrollback::set_max_bytes(std::size_t const bytes)
+{
+    max_bytes = bytes;
+    if (max_bytes == 0)
+        clear();
+    else
+        evict();
+}
+
+std::size_t scrollback::max_memory() const
+{
+    return max_bytes;
+}
+
+std::size_t scrollback::memory_usage() const
+{
+    return used_bytes;
+}
+
+void scrollback::clear()
+{
+    first_chunk += chunks.size();
+    chunks.clear();
+    lines.clear();
+    used_bytes = 0;
+    any_wrapped = false;
+    longest = 0;
+}
+
+void scrollback::make_cold(std::size_t const chunk_index)
+{
+    auto& c = chunks[chunk_index];
+    if (c.cold)
+        return;
+
+    auto const id = first_chunk + chunk_index;
+    auto line = std::lower_bound(lines.begin(), lines.end(), id,
+        [](line_ref const& ref, std::size_t const chunk) {
+            return ref.chunk < chunk;
+        });
+
+    for (; line != lines.end() && line->chunk == id; ++line) {
+        auto const offset = static_cast<std::uint32_t>(c.encoded.size());
+        encode_line(c.glyphs.data() + line->offset, line->length, c.palette, c.encoded);
+        line->offset = offset;
+    }
+
+    c.encoded.shrink_to_fit();
+    used_bytes -= chunk_bytes(c.glyphs, c.palette_bytes);
+    used_bytes += c.encoded.size();
+
+    std::vector<packed_glyph>{}.swap(c.glyphs);
+    c.palette = colour_palette{};
+    c.palette_bytes = 0;
+    c.cold = true;
+}
+
+void scrollback::evict()
+{
+    while (used_bytes > max_bytes && chunks.size() > 1) {
+        auto const& front = chunks.front();
+        used_bytes -= front.cold
+                    ? front.encoded.size()
+                    : chunk_bytes(front.glyphs, front.palette_bytes);
+        chunks.pop_front();
+
+        while (!lines.empty() && lines.front().chunk == first_chunk) {
+            lines.pop_front();
+            used_bytes -= sizeof(line_ref);
+        }
+
+        ++first_chunk;
+    }
+}
+
+} // katerm::
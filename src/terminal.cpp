@@ -8,6 +8,77 @@ namespace katerm {
 
 static_assert(std::is_copy_assignable_v<terminal>);
 
+namespace {
+
+constexpr code_point zero_width_joiner = 0x200d;
+
+code_point translate_char(charset const cs, code_point const ch)
+{
+    // The table is proudly stolen from st from rxvt.
+    static char32_t const vt100_0[] = {
+        U'↑', U'↓', U'→', U'←', U'█', U'▚', U'☃',
+        0   , 0   , 0   , 0   , 0   , 0   , 0   , 0   ,
+        0   , 0   , 0   , 0   , 0   , 0   , 0   , 0   ,
+        0   , 0   , 0   , 0   , 0   , 0   , 0   , U' ',
+        U'◆', U'▒', U'␉', U'␌', U'␍', U'␊', U'°', U'±',
+        U'␤', U'␋', U'┘', U'┐', U'┌', U'└', U'┼', U'⎺',
+        U'⎻', U'─', U'⎼', U'⎽', U'├', U'┤', U'┴', U'┬',
+        U'│', U'≤', U'≥', U'π', U'≠', U'£', U'·',
+    };
+
+    if (cs == charset::graphic0 &&
+        ch >= 0x41 && ch <= 0x7e && vt100_0[ch - 0x41] != 0)
+    {
+        return vt100_0[ch - 0x41];
+    }
+
+    return ch;
+}
+
+// Writes as many one column wide characters as fit on the cursor's line in one
+// go. Stops at the first character for which is_narrow returns false.
+// Behaves like calling write_char for every character written, except that the
+// written columns are only marked dirty once. Insert mode is not handled here.
+template<class Char, class IsNarrow>
+int fill_line(terminal& term, Char const* const chars, int const count, IsNarrow is_narrow)
+{
+    if (count == 0 || !is_narrow(chars[0]))
+        return 0;
+
+    if (term.cursor.state.is_set(cursor_state_bit::wrap_next)) {
+        term.glyph_at_cursor()->style.mode.set(glyph_attr_bit::text_wraps);
+        term.newline(true);
+    }
+
+    auto const width = term.screen.size().width;
+    auto const y = term.cursor.pos.y;
+    auto* const line = term.screen.edit_line(y, std::min(width, term.cursor.pos.x + count));
+    auto const cs = term.current_charset();
+    auto const style = term.cursor.style;
+
+    auto x = term.cursor.pos.x;
+    auto written = 0;
+    while (written != count && x != width && is_narrow(chars[written])) {
+        auto const ch = static_cast<code_point>(chars[written]);
+        line[x] = {style, translate_char(cs, ch)};
+        ++x;
+        ++written;
+    }
+
+    term.screen.mark_dirty_columns(y, term.cursor.pos.x, x);
+
+    if (x == width) {
+        term.cursor.pos.x = width - 1;
+        term.cursor.state.set(cursor_state_bit::wrap_next);
+    } else {
+        term.move_cursor({x, y});
+    }
+
+    return written;
+}
+
+} // anonymous namespace
+
 charset terminal::current_charset() const
 {
     return translation_tables[using_translation_table];
@@ -15,8 +86,25 @@ charset terminal::current_charset() const
 
 void terminal::resize(extend const new_size)
 {
-    auto new_y = screen.resize(new_size, cursor.pos.y, clear_glyph());
-    cursor.pos.y = new_y;
+    // Like xterm the scroll region is reset
+    scroll_top = 0;
+    scroll_bottom = new_size.height;
+
+    // Without soft wrapped or cut off lines reflowing changes nothing,
+    // resizing in place is cheaper as it leaves the scrollback alone.
+    if (new_size.width == screen.size().width || !screen.needs_reflow(new_size.width))
+        cursor.pos.y = screen.resize(new_size, cursor.pos.y, clear_glyph());
+    else
+        cursor.pos = screen.reflow(new_size, cursor.pos);
+
+    // The cursor is on the last glyph written, it only stays there when
+    // that's still the end of a row.
+    if (cursor.state.is_set(cursor_state_bit::wrap_next)
+            && cursor.pos.x != new_size.width - 1) {
+        cursor.state.set(cursor_state_bit::wrap_next, false);
+        ++cursor.pos.x;
+    }
+
     cursor.pos = clamp_pos(cursor.pos);
 }
 
@@ -29,10 +117,11 @@ void terminal::tab()
 
 void terminal::newline(bool const first_column)
 {
-    if (cursor.pos.y + 1 < screen.size().height) {
+    // Below the scroll region the cursor stops at the last line.
+    if (cursor.pos.y + 1 == scroll_bottom) {
+        scroll_up(1);
+    } else if (cursor.pos.y + 1 < screen.size().height) {
         cursor.pos.y++;
-    } else {
-        scroll_up(0, 1);
     }
 
     if (first_column)
@@ -41,10 +130,22 @@ void terminal::newline(bool const first_column)
 
 void terminal::write_char(code_point const ch)
 {
+    // Control characters the decoder didn't handle, NUL included, are
+    // dropped. NUL counts as zero width and would join the previous cluster.
+    if (ch < 0x20 || ch == 0x7f)
+        return;
+
     auto const width{cw::character_width(ch)};
     if (width == -1)
         return;
 
+    // Combining characters and emoji joined to the previous one with a zero
+    // width joiner don't get a cell of their own.
+    if (width == 0 || (width == 2 && follows_joiner())) {
+        add_to_cluster(ch);
+        return;
+    }
+
     auto* gl{glyph_at_cursor()};
     if (cursor.state.is_set(cursor_state_bit::wrap_next)) {
         gl->style.mode.set(glyph_attr_bit::text_wraps);
@@ -53,15 +154,19 @@ void terminal::write_char(code_point const ch)
     }
 
     if (cursor.pos.x + width > screen.size().width) {
+        gl->style.mode.set(glyph_attr_bit::text_wraps);
         newline(true);
         gl = glyph_at_cursor();
     }
 
     if (mode.is_set(terminal_mode_bit::insert)) {
+        KATERM_COUNT(insert_mode_chars, 1);
         std::move_backward(
             screen.get_line(cursor.pos.y) + cursor.pos.x,
             screen.get_line(cursor.pos.y) + screen.size().width - width,
             screen.get_line(cursor.pos.y) + screen.size().width);
+
+        screen.mark_dirty_columns(cursor.pos.y, cursor.pos.x, screen.size().width);
     }
 
     set_char(ch, width, cursor.style, cursor.pos);
@@ -80,6 +185,56 @@ void terminal::write_char(code_point const ch)
     }
 }
 
+void terminal::write_chars(code_point const* chars, int count)
+{
+    if (mode.is_set(terminal_mode_bit::insert)) {
+        for (int i = 0; i != count; ++i)
+            write_char(chars[i]);
+
+        return;
+    }
+
+    auto const is_narrow = [](code_point const ch) {
+        return cw::character_width(ch) == 1;
+    };
+
+    while (count > 0) {
+        auto written = fill_line(*this, chars, count, is_narrow);
+        if (written == 0) {
+            write_char(chars[0]);
+            written = 1;
+        }
+
+        chars += written;
+        count -= written;
+    }
+}
+
+void terminal::write_ascii(char const* chars, int count)
+{
+    if (mode.is_set(terminal_mode_bit::insert)) {
+        for (int i = 0; i != count; ++i)
+            write_char(static_cast<code_point>(chars[i]));
+
+        return;
+    }
+
+    auto const is_printable = [](char const ch) {
+        return ch >= 0x20 && ch <= 0x7e;
+    };
+
+    while (count > 0) {
+        auto written = fill_line(*this, chars, count, is_printable);
+        if (written == 0) {
+            write_char(static_cast<code_point>(chars[0]));
+            written = 1;
+        }
+
+        chars += written;
+        count -= written;
+    }
+}
+
 void terminal::move_cursor(position const pos)
 {
     cursor.pos = clamp_pos(pos);
@@ -99,25 +254,9 @@ void terminal::set_char(
 {
     pos = clamp_pos(pos);
 
-    // The table is proudly stolen from st from rxvt.
-    static char32_t vt100_0[] = {
-        U'↑', U'↓', U'→', U'←', U'█', U'▚', U'☃',
-        0   , 0   , 0   , 0   , 0   , 0   , 0   , 0   ,
-        0   , 0   , 0   , 0   , 0   , 0   , 0   , 0   ,
-        0   , 0   , 0   , 0   , 0   , 0   , 0   , U' ',
-        U'◆', U'▒', U'␉', U'␌', U'␍', U'␊', U'°', U'±',
-        U'␤', U'␋', U'┘', U'┐', U'┌', U'└', U'┼', U'⎺',
-        U'⎻', U'─', U'⎼', U'⎽', U'├', U'┤', U'┴', U'┬',
-        U'│', U'≤', U'≥', U'π', U'≠', U'£', U'·',
-    };
+    ch = translate_char(current_charset(), ch);
 
-    if (current_charset() == charset::graphic0 &&
-        ch >= 0x41 && ch <= 0x7e && vt100_0[ch - 0x41] != 0)
-    {
-        ch = vt100_0[ch - 0x41];
-    }
-
-    mark_dirty(pos.y);
+    screen.mark_dirty_columns(pos.y, pos.x, pos.x + width);
     screen.get_glyph(pos) = {style, ch};
 
     if (width == 2) {
@@ -146,14 +285,38 @@ void terminal::mark_dirty(int const line_beg, int const line_end)
     screen.mark_dirty(line_beg, line_end);
 }
 
-void terminal::scroll_up(int keep_top, int const count)
+void terminal::scroll_up(int const count)
 {
-    screen.scroll_up(keep_top, count, clear_glyph());
+    screen.scroll_up(scroll_top, scroll_bottom, count, clear_glyph());
 }
 
-void terminal::scroll_down(int keep_top, int const count)
+void terminal::scroll_down(int const count)
 {
-    screen.scroll_down(keep_top, count, clear_glyph());
+    screen.scroll_down(scroll_top, scroll_bottom, count, clear_glyph());
+}
+
+void terminal::set_scroll_region(int const top, int bottom)
+{
+    auto const height = screen.size().height;
+    if (bottom <= 0 || bottom > height)
+        bottom = height;
+
+    if (top < 0 || top + 1 >= bottom)
+        return;
+
+    scroll_top = top;
+    scroll_bottom = bottom;
+    move_cursor({0, 0});
+}
+
+int terminal::scroll_region_top() const
+{
+    return scroll_top;
+}
+
+int terminal::scroll_region_bottom() const
+{
+    return scroll_bottom;
 }
 
 void terminal::clear_lines(int line_beg, int line_end)
@@ -174,18 +337,20 @@ void terminal::clear(position start, position end)
         code_point{0}
     };
 
-    auto it = start;
-    while(it != end) {
-        screen.get_glyph(it) = fill_glyph;
-        ++it.x;
-        if (it.x == screen.size().width) {
-            it.x = 0;
-            ++it.y;
+    auto const width = screen.size().width;
+    for (auto y = start.y; y <= end.y; ++y) {
+        auto const x_beg = y == start.y ? start.x : 0;
+        auto const x_end = y == end.y ? end.x + 1 : width;
+
+        if (x_end == width) {
+            screen.clear_line_from(y, x_beg, fill_glyph);
+        } else {
+            auto* const line = screen.edit_line(y, x_end);
+            std::fill(line + x_beg, line + x_end, fill_glyph);
         }
-    }
-    screen.get_glyph(end) = fill_glyph;
 
-    mark_dirty(start.y, end.y + 1);
+        screen.mark_dirty_columns(y, x_beg, x_end);
+    }
 }
 
 void terminal::delete_chars(int count)
@@ -196,6 +361,8 @@ void terminal::delete_chars(int count)
         screen.get_line(cursor.pos.y) + screen.size().width,
         screen.get_line(cursor.pos.y) + cursor.pos.x);
 
+    screen.mark_dirty_columns(cursor.pos.y, cursor.pos.x, screen.size().width);
+
     clear({screen.size().width - count, cursor.pos.y},
           {screen.size().width - 1, cursor.pos.y});
 }
@@ -215,12 +382,100 @@ void terminal::insert_blanks(int count)
         this_line + screen.size().width - count,
         this_line + screen.size().width);
 
+    screen.mark_dirty_columns(cursor.pos.y, cursor.pos.x, width);
+
     clear(cursor.pos, {cursor.pos.x + count - 1, cursor.pos.y});
 }
 
+// Inserting and deleting lines only moves the lines of the scroll region
+// below the cursor, and does nothing outside of the region.
+
 void terminal::insert_newline(int const count)
 {
-    scroll_down(cursor.pos.y, count);
+    if (cursor.pos.y >= scroll_top && cursor.pos.y < scroll_bottom)
+        screen.scroll_down(cursor.pos.y, scroll_bottom, count, clear_glyph());
+}
+
+void terminal::delete_lines(int const count)
+{
+    if (cursor.pos.y >= scroll_top && cursor.pos.y < scroll_bottom)
+        screen.delete_lines(cursor.pos.y, scroll_bottom, count, clear_glyph());
+}
+
+void terminal::reverse_newline()
+{
+    if (cursor.pos.y == scroll_top) {
+        scroll_down(1);
+    } else if (cursor.pos.y > 0) {
+        move_cursor({cursor.pos.x, cursor.pos.y - 1});
+    }
+}
+
+bool terminal::previous_glyph_pos(position& pos) const
+{
+    // A glyph in the last column leaves the cursor on it.
+    if (cursor.state.is_set(cursor_state_bit::wrap_next)) {
+        pos = cursor.pos;
+        return true;
+    }
+
+    if (cursor.pos.x == 0)
+        return false;
+
+    pos = {cursor.pos.x - 1, cursor.pos.y};
+    if (pos.x > 0 && screen.get_glyph(pos).style.mode.is_set(glyph_attr_bit::wdummy))
+        --pos.x;
+
+    return true;
+}
+
+bool terminal::follows_joiner() const
+{
+    auto pos = position{};
+    if (!previous_glyph_pos(pos))
+        return false;
+
+    auto const& gl = screen.get_glyph(pos);
+    if (!gl.style.mode.is_set(glyph_attr_bit::cluster))
+        return false;
+
+    auto const cluster = screen.clusters().get(gl.code);
+    return cluster.code_points[cluster.count - 1] == zero_width_joiner;
+}
+
+void terminal::add_to_cluster(code_point const ch)
+{
+    auto pos = position{};
+    if (!previous_glyph_pos(pos))
+        return;
+
+    auto& gl = screen.get_glyph(pos);
+
+    // Copied out, the cluster's code points can move when interning.
+    code_point code_points[cluster_table::max_cluster_length + 1];
+    auto count = 0;
+    if (gl.style.mode.is_set(glyph_attr_bit::cluster)) {
+        auto const cluster = screen.clusters().get(gl.code);
+        count = cluster.count;
+        std::copy(cluster.code_points, cluster.code_points + count, code_points);
+    } else {
+        code_points[count++] = gl.code;
+    }
+
+    if (count == cluster_table::max_cluster_length)
+        return;
+
+    code_points[count++] = ch;
+
+    auto const id = screen.intern_cluster(code_points, count);
+    if (id == 0)
+        return;
+
+    gl.code = id;
+    gl.style.mode.set(glyph_attr_bit::cluster);
+
+    auto const width = gl.style.mode.is_set(glyph_attr_bit::wide) ? 2 : 1;
+    screen.mark_dirty_columns(pos.y, pos.x, pos.x + width);
 }
 
 position terminal::clamp_pos(position p) const
@@ -253,5 +508,10 @@ glyph terminal::clear_glyph() const
     return {clear_style(), code_point{0}};
 }
 
+terminal_stats terminal::stats() const
+{
+    return {screen.stats(), insert_mode_chars};
+}
+
 
 } // katerm::
@@ -28,6 +28,16 @@ void terminal_instructee::write_char(code_point code)
     term->write_char(code);
 }
 
+void terminal_instructee::write_chars(code_point const* chars, int count)
+{
+    term->write_chars(chars, count);
+}
+
+void terminal_instructee::write_ascii(char const* chars, int count)
+{
+    term->write_ascii(chars, count);
+}
+
 void terminal_instructee::clear_to_bottom()
 {
     term->clear(
@@ -138,16 +148,12 @@ void terminal_instructee::erase_chars(int count)
 
 void terminal_instructee::delete_lines(int count)
 {
-    term->scroll_up(term->cursor.pos.y, count);
+    term->delete_lines(count);
 }
 
 void terminal_instructee::reverse_line_feed()
 {
-    if (term->cursor.pos.y == 0) {
-        term->scroll_down();
-    } else {
-        term->move_cursor({term->cursor.pos.x, term->cursor.pos.y - 1});
-    }
+    term->reverse_newline();
 }
 
 void terminal_instructee::insert_blanks(int count)
@@ -160,6 +166,11 @@ void terminal_instructee::insert_newline(int count)
     term->insert_newline(count);
 }
 
+void terminal_instructee::set_scroll_region(int top, int bottom)
+{
+    term->set_scroll_region(top, bottom);
+}
+
 void terminal_instructee::set_charset_table(int table_index, charset cs)
 {
     term->translation_tables[table_index] = cs;
@@ -223,4 +234,7 @@ void terminal_instructee::set_bracketed_paste(bool set)
     term->mode.set(terminal_mode_bit::bracketed_paste, set);
 }
 
+// Instantiated here so the forwarding functions above can be inlined into it.
+template class basic_decoder<terminal_instructee>;
+
 } // katerm::
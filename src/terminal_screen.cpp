@@ -1,23 +1,58 @@
 #include <type_traits>
 #include <algorithm>
+#include <atomic>
+#include <deque>
 
 #include <katerm/terminal_screen.hpp>
+#include <katerm/terminal_data.hpp>
 
 namespace katerm {
 
 static_assert(std::is_copy_assignable_v<terminal_screen>);
 
+namespace {
+
+// Whether the unused part of a line with this fill can be left out of the
+// scrollback, readers draw missing glyphs as default blanks.
+bool is_default_blank(glyph const& g)
+{
+    return g.code == 0
+        && g.style.mode == glyph_attribute{}
+        && to_u32(g.style.bg) == to_u32(default_style.bg);
+}
+
+bool same_glyph(glyph const& a, glyph const& b)
+{
+    return a.code == b.code
+        && a.style.mode == b.style.mode
+        && to_u32(a.style.fg) == to_u32(b.style.fg)
+        && to_u32(a.style.bg) == to_u32(b.style.bg);
+}
+
+// The glyph of a row that holds text_wraps: the last one that isn't the
+// wdummy of a wide glyph, like the glyph under the cursor when writing wraps.
+// Returns end for rows of nothing but wdummies.
+template<class Glyph>
+Glyph* wrap_glyph(Glyph* const begin, Glyph* end)
+{
+    while (end != begin && (end - 1)->style.mode.is_set(glyph_attr_bit::wdummy))
+        --end;
+
+    return end == begin ? end : end - 1;
+}
+
+struct reflow_row {
+    std::vector<glyph> glyphs;
+    glyph fill;
+};
+
+} // anonymous namespace
+
 terminal_screen::terminal_screen(extend screen_sz)
     : m_size{screen_sz}
-    , data(m_size.width * m_size.height, glyph{})
+    , lines(m_size.height, line{std::vector<glyph>(m_size.width)})
+    , m_clusters{std::make_shared<cluster_table>()}
 {
-    lines.resize(m_size.height);
-    int index = 0;
-    for(auto& line : lines) {
-        line.glyphs = data.data() + index * m_size.width;
-        line.changed = false;
-        ++index;
-    }
 }
 
 int terminal_screen::resize(
@@ -38,15 +73,226 @@ int terminal_screen::resize(
 
 void terminal_screen::resize(extend new_size)
 {
-    auto replacement = terminal_screen{new_size};
-    for (auto line = 0; line < new_size.height && line < size().height; ++line) {
-        for (auto x = 0; x < new_size.width && x < size().width; ++x) {
-            replacement.lines[line].glyphs[x] = lines[line].glyphs[x];
+    auto const old_height = size().height;
+
+    // Lines are added and removed at the bottom.
+    if (m_head != 0) {
+        std::rotate(lines.begin(), lines.begin() + m_head, lines.end());
+        m_head = 0;
+    }
+
+    lines.resize(new_size.height, line{std::vector<glyph>(new_size.width)});
+
+    // Storage only ever grows, shrinking just forgets the glyphs past the
+    // new width. Neither changes what the remaining columns show.
+    for (auto& info : lines) {
+        if (static_cast<int>(info.glyphs.size()) < new_size.width)
+            info.glyphs.resize(new_size.width);
+
+        info.used = std::min(info.used, new_size.width);
+    }
+
+    m_size = new_size;
+
+    // A pending scroll delta is meaningless with a different height.
+    if (new_size.height != old_height && m_scroll.count != 0) {
+        m_scroll = {};
+        mark_dirty(0, new_size.height);
+    } else {
+        mark_dirty(old_height, new_size.height);
+    }
+}
+
+position terminal_screen::reflow(extend const new_size, position const cursor)
+{
+    auto const width = new_size.width;
+    auto const columns = static_cast<std::size_t>(width);
+
+    // Rows that can't end up on the screen go straight to the new history.
+    // Only empty rows below the content can follow the screen's rows, and
+    // there are at most as many of those as the old screen has lines.
+    auto const keep = static_cast<std::size_t>(new_size.height + size().height);
+    auto history = scrollback{m_history.max_memory()};
+    auto rows = std::deque<reflow_row>{};
+    auto dropped = std::size_t{};
+
+    auto const push_history = [&](reflow_row& row) {
+        if (!is_default_blank(row.fill))
+            row.glyphs.resize(std::max(row.glyphs.size(), columns), row.fill);
+
+        history.push_line(row.glyphs.data(), static_cast<int>(row.glyphs.size()));
+    };
+
+    auto const next_row = [&] {
+        return dropped + rows.size();
+    };
+
+    auto const emit = [&](reflow_row&& row) {
+        rows.push_back(std::move(row));
+        if (rows.size() > keep) {
+            push_history(rows.front());
+            rows.pop_front();
+            ++dropped;
         }
+    };
+
+    auto logical = std::vector<glyph>{};
+    auto logical_fill = glyph{};
+    auto cursor_line = false;
+    auto cursor_offset = std::size_t{};
+    auto cursor_row = std::size_t{};
+    auto cursor_col = std::size_t{};
+    auto content_end = std::size_t{};
+
+    auto const mark_wrapped = [](reflow_row& row) {
+        auto* const end = row.glyphs.data() + row.glyphs.size();
+        auto* const g = wrap_glyph(row.glyphs.data(), end);
+        if (g != end)
+            g->style.mode.set(glyph_attr_bit::text_wraps);
+    };
+
+    auto const wrap_logical = [&] {
+        auto length = logical.size();
+        while (length > 0 && same_glyph(logical[length - 1], logical_fill))
+            --length;
+
+        auto row = reflow_row{{}, logical_fill};
+        for (std::size_t i = 0; i != length; ++i) {
+            auto const& g = logical[i];
+            auto const glyph_width = g.style.mode.is_set(glyph_attr_bit::wide) ? 2u : 1u;
+
+            // Wide glyphs that don't fit leave a blank behind, like writing
+            // them does.
+            if (!row.glyphs.empty() && row.glyphs.size() + glyph_width > columns) {
+                row.glyphs.resize(columns, glyph{logical_fill.style, 0});
+                mark_wrapped(row);
+                emit(std::move(row));
+                row = reflow_row{{}, logical_fill};
+            }
+
+            if (cursor_line && i == cursor_offset) {
+                cursor_row = next_row();
+                cursor_col = row.glyphs.size();
+            }
+
+            row.glyphs.push_back(g);
+        }
+
+        if (cursor_line && cursor_offset >= length) {
+            auto col = row.glyphs.size() + (cursor_offset - length);
+            // Rows the cursor pushes into still count as wrapped, so that
+            // the cursor comes back when widening again.
+            for (; col >= columns; col -= columns) {
+                row.glyphs.resize(columns, glyph{logical_fill.style, 0});
+                mark_wrapped(row);
+                emit(std::move(row));
+                row = reflow_row{{}, logical_fill};
+            }
+
+            cursor_row = next_row();
+            cursor_col = col;
+        }
+
+        if (length > 0 || !is_default_blank(logical_fill) || cursor_line)
+            content_end = next_row() + 1;
+
+        emit(std::move(row));
+        logical.clear();
+        cursor_line = false;
+    };
+
+    auto const add_row = [&](glyph const* glyphs, int const count, glyph const& fill, int const cursor_x) {
+        // Drop the blank left by a wide glyph that didn't fit.
+        if (!logical.empty() && count > 0 && glyphs[0].style.mode.is_set(glyph_attr_bit::wide)) {
+            auto const& last = logical.back();
+            if (last.code == 0 && !last.style.mode.is_set(glyph_attr_bit::wdummy))
+                logical.pop_back();
+        }
+
+        if (cursor_x >= 0) {
+            cursor_line = true;
+            cursor_offset = logical.size() + cursor_x;
+        }
+
+        logical.insert(logical.end(), glyphs, glyphs + count);
+        logical_fill = fill;
+
+        auto* const end = logical.data() + logical.size();
+        auto* const wraps = wrap_glyph(end - count, end);
+
+        if (wraps != end && wraps->style.mode.is_set(glyph_attr_bit::text_wraps))
+            wraps->style.mode.set(glyph_attr_bit::text_wraps, false);
+        else
+            wrap_logical();
+    };
+
+    auto buffer = std::vector<glyph>{};
+    for (std::size_t i = 0; i != m_history.size(); ++i) {
+        buffer.clear();
+        m_history.read_line(i, buffer);
+        add_row(buffer.data(), static_cast<int>(buffer.size()), glyph{}, -1);
+    }
+
+    for (auto y = 0; y != size().height; ++y) {
+        add_row(
+            stored_glyphs(y), line_length(y), line_fill(y),
+            y == cursor.y ? cursor.x : -1);
+    }
+
+    if (!logical.empty())
+        wrap_logical();
+
+    auto const height = static_cast<std::size_t>(new_size.height);
+    auto const bottom = std::max(content_end, cursor_row + 1);
+    auto const top = std::max(bottom, height) - height;
+
+    for (; dropped != top; ++dropped) {
+        push_history(rows.front());
+        rows.pop_front();
     }
 
-    *this = std::move(replacement);
-    mark_dirty(0, size().height);
+    lines.clear();
+    for (auto& row : rows) {
+        if (lines.size() == height)
+            break;
+
+        auto const used = static_cast<int>(row.glyphs.size());
+        row.glyphs.resize(std::max(used, width));
+        lines.push_back(line{std::move(row.glyphs), 0, width, used, row.fill});
+    }
+
+    lines.resize(height, line{std::vector<glyph>(width), 0, width});
+
+    m_size = new_size;
+    m_head = 0;
+    m_scroll = {};
+    m_history = std::move(history);
+
+    return {static_cast<int>(cursor_col), static_cast<int>(cursor_row - top)};
+}
+
+bool terminal_screen::needs_reflow(int const new_width) const
+{
+    auto const narrower = new_width < size().width;
+
+    if (m_history.has_wrapped_lines())
+        return true;
+
+    if (narrower && m_history.longest_line() > static_cast<std::size_t>(new_width))
+        return true;
+
+    for (auto y = 0; y != size().height; ++y) {
+        auto const& info = line_info(y);
+        if (narrower && info.used > new_width)
+            return true;
+
+        auto const* const begin = info.glyphs.data();
+        auto const* const wraps = wrap_glyph(begin, begin + info.used);
+        if (wraps != begin + info.used && wraps->style.mode.is_set(glyph_attr_bit::text_wraps))
+            return true;
+    }
+
+    return false;
 }
 
 void terminal_screen::fill_lines(int line_beg, int line_end, glyph fill_glyph)
@@ -55,79 +301,191 @@ void terminal_screen::fill_lines(int line_beg, int line_end, glyph fill_glyph)
     line_beg = std::clamp(line_beg, 0, line_end);
 
     for(auto line_it{line_beg}; line_it != line_end; ++line_it) {
-        std::fill(
-            get_line(line_it),
-            get_line(line_it) + size().width,
-            fill_glyph);
+        auto& info = line_info(line_it);
+        info.used = 0;
+        info.fill = fill_glyph;
     }
 
     mark_dirty(line_beg, line_end);
 }
 
-void terminal_screen::scroll_up(int keep_top, int const count, glyph fill)
+void terminal_screen::scroll_up(int top, int bottom, int count, glyph fill)
 {
-    auto const height = size().height;
-
-    keep_top = std::clamp(keep_top, 0, height);
-    auto const move_end = height;
-    auto const move_to = std::clamp(keep_top + count, 0, height);
+    if (top <= 0) {
+        auto const lines = std::clamp(count, 0, std::clamp(bottom, 0, size().height));
+        for (auto line = 0; line != lines; ++line) {
+            auto const& info = line_info(line);
+            auto const length = is_default_blank(info.fill) ? info.used : size().width;
+            m_history.push_line(edit_line(line, length), length);
+        }
+    }
 
-    std::rotate(
-        lines.begin() + keep_top,
-        lines.begin() + move_to,
-        lines.begin() + move_end);
+    delete_lines(top, bottom, count, fill);
+}
 
-    fill_lines(move_end - count, move_end, fill);
+void terminal_screen::delete_lines(int top, int bottom, int count, glyph fill)
+{
+    auto const height = size().height;
 
-    if (keep_top < height / 2) {
-        mark_dirty(0, keep_top);
-        move_scroll(count);
+    bottom = std::clamp(bottom, 0, height);
+    top = std::clamp(top, 0, bottom);
+    count = std::clamp(count, 0, bottom - top);
+    if (count == 0)
+        return;
+
+    KATERM_COUNT(m_stats.scroll_ups, 1);
+    KATERM_COUNT(m_stats.lines_scrolled, count);
+
+    add_scroll(top, bottom, count);
+
+    if (top == 0 && bottom == height) {
+        // Lines scrolled off the top become the new lines at the bottom
+        m_head = (m_head + count) % height;
+    } else if (height - (bottom - top) + count < bottom - top) {
+        // Moving the whole ring and putting the lines outside of the region
+        // back is less work, like for a region above a status line.
+        m_head = (m_head + count) % height;
+        rotate_lines(bottom - count, top + height - count, top + height);
     } else {
-        mark_dirty(keep_top, move_end);
+        rotate_lines(top, top + count, bottom);
     }
+
+    fill_lines(bottom - count, bottom, fill);
 }
 
-void terminal_screen::scroll_down(int keep_top, int const count, glyph fill)
+void terminal_screen::scroll_down(int top, int bottom, int count, glyph fill)
 {
     auto const height = size().height;
 
-    keep_top = std::clamp(keep_top, 0, height);
-    auto const move_end = height;
-    auto const move_to = std::clamp(move_end - count, keep_top, height);
+    bottom = std::clamp(bottom, 0, height);
+    top = std::clamp(top, 0, bottom);
+    count = std::clamp(count, 0, bottom - top);
+    if (count == 0)
+        return;
 
-    std::rotate(
-        lines.begin() + keep_top,
-        lines.begin() + move_to,
-        lines.begin() + move_end);
+    KATERM_COUNT(m_stats.scroll_downs, 1);
+    KATERM_COUNT(m_stats.lines_scrolled, count);
 
-    fill_lines(move_end - count, move_end, fill);
+    add_scroll(top, bottom, -count);
 
-    if (keep_top < height / 2) {
-        mark_dirty(0, keep_top);
-        move_scroll(-count);
+    if (top == 0 && bottom == height) {
+        m_head = (m_head + height - count) % height;
+    } else if (height - (bottom - top) + count < bottom - top) {
+        m_head = (m_head + height - count) % height;
+        rotate_lines(bottom, bottom + count, top + count + height);
     } else {
-        mark_dirty(keep_top, move_end);
+        rotate_lines(top, bottom - count, bottom);
     }
+
+    fill_lines(top, top + count, fill);
+}
+
+void terminal_screen::scroll_up(int const keep_top, int const count, glyph const fill)
+{
+    scroll_up(keep_top, size().height, count, fill);
+}
+
+void terminal_screen::scroll_down(int const keep_top, int const count, glyph const fill)
+{
+    scroll_down(keep_top, size().height, count, fill);
+}
+
+scrollback& terminal_screen::history()
+{
+    return m_history;
+}
+
+scrollback const& terminal_screen::history() const
+{
+    return m_history;
+}
+
+cluster_table const& terminal_screen::clusters() const
+{
+    return *m_clusters;
+}
+
+std::shared_ptr<cluster_table const> terminal_screen::shared_clusters() const
+{
+    return m_clusters;
+}
+
+cluster_table::id_type terminal_screen::intern_cluster(
+        code_point const* const code_points,
+        int const count)
+{
+    // Frames usually share the table, only copy it when a cluster is added.
+    if (auto const existing = m_clusters->find(code_points, count))
+        return existing;
+
+    // Existing ids stay the same in the copy, so glyphs referencing them
+    // don't need to know which table they came from.
+    if (m_clusters.use_count() != 1)
+        m_clusters = std::make_shared<cluster_table>(*m_clusters);
+
+    // use_count is a relaxed load. A frame dropped on another thread may
+    // have read the table just before releasing it, this orders those reads
+    // before the writes below.
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return m_clusters->intern(code_points, count);
 }
 
 glyph* terminal_screen::get_line(int line)
 {
-    return lines[line].glyphs;
+    return edit_line(line, size().width);
 }
 
 glyph& terminal_screen::get_glyph(position pos)
 {
-    return get_line(pos.y)[pos.x];
+    return edit_line(pos.y, pos.x + 1)[pos.x];
 }
 
-const glyph* terminal_screen::get_line(int line) const
+glyph* terminal_screen::edit_line(int const line, int const end)
 {
-    return lines[line].glyphs;
+    auto& info = line_info(line);
+    auto* const glyphs = info.glyphs.data();
+
+    if (info.used < end) {
+        std::fill(glyphs + info.used, glyphs + end, info.fill);
+        info.used = end;
+    }
+
+    return glyphs;
+}
+
+void terminal_screen::clear_line_from(int const line, int const x, glyph const fill)
+{
+    // The part before x has to keep the old fill.
+    edit_line(line, x);
+
+    auto& info = line_info(line);
+    info.used = x;
+    info.fill = fill;
+}
+
+const glyph* terminal_screen::stored_glyphs(int line) const
+{
+    return line_info(line).glyphs.data();
 }
 
 const glyph& terminal_screen::get_glyph(position pos) const
 {
-    return get_line(pos.y)[pos.x];
+    auto const& info = line_info(pos.y);
+    if (pos.x >= info.used)
+        return info.fill;
+
+    return info.glyphs[pos.x];
+}
+
+int terminal_screen::line_length(int const line) const
+{
+    return line_info(line).used;
+}
+
+glyph const& terminal_screen::line_fill(int const line) const
+{
+    return line_info(line).fill;
 }
 
 extend terminal_screen::size() const
@@ -141,35 +499,140 @@ void terminal_screen::mark_dirty(int start, int end)
     start = std::clamp(start, 0, height);
     end = std::clamp(end, 0, height);
 
-    while(start < end)
-        lines[start++].changed = true;
+    while(start < end) {
+        auto& info = line_info(start++);
+        KATERM_COUNT(m_stats.lines_dirtied, info.dirty_beg == info.dirty_end);
+        info.dirty_beg = 0;
+        info.dirty_end = size().width;
+    }
+}
+
+void terminal_screen::mark_dirty_columns(int const line, int x_beg, int x_end)
+{
+    x_end = std::clamp(x_end, 0, size().width);
+    x_beg = std::clamp(x_beg, 0, x_end);
+    if (x_beg == x_end)
+        return;
+
+    auto& info = line_info(line);
+    if (info.dirty_beg == info.dirty_end) {
+        KATERM_COUNT(m_stats.lines_dirtied, 1);
+        info.dirty_beg = x_beg;
+        info.dirty_end = x_end;
+    } else {
+        info.dirty_beg = std::min(info.dirty_beg, x_beg);
+        info.dirty_end = std::max(info.dirty_end, x_end);
+    }
+}
+
+bool terminal_screen::line_changed(int const line) const
+{
+    auto const& info = line_info(line);
+    return info.dirty_beg != info.dirty_end;
+}
+
+rect terminal_screen::line_damage(int const line) const
+{
+    // Spans can be wider than the line after shrinking the screen.
+    auto const& info = line_info(line);
+    auto const x_end = std::min(info.dirty_end, size().width);
+    auto const x_beg = std::min(info.dirty_beg, x_end);
+    return {x_beg, x_end, line, line + 1};
 }
 
-int terminal_screen::changed_scroll() const
+std::vector<rect> terminal_screen::damage() const
+{
+    auto result = std::vector<rect>{};
+    for (auto y = 0; y != size().height; ++y) {
+        auto const r = line_damage(y);
+        if (r.x_beg == r.x_end)
+            continue;
+
+        if (!result.empty()) {
+            auto& last = result.back();
+            if (last.y_end == y && last.x_beg == r.x_beg && last.x_end == r.x_end) {
+                last.y_end = r.y_end;
+                continue;
+            }
+        }
+
+        result.push_back(r);
+    }
+
+    return result;
+}
+
+bool terminal_screen::has_changes() const
+{
+    if (m_scroll.count != 0)
+        return true;
+
+    return std::any_of(lines.begin(), lines.end(), [](auto const& info) {
+        return info.dirty_beg != info.dirty_end;
+    });
+}
+
+scroll_change terminal_screen::changed_scroll() const
 {
     return m_scroll;
 }
 
 void terminal_screen::clear_changes()
 {
-    set_scroll(0);
-    for (auto& line : lines)
-        line.changed = false;
+    m_scroll = {};
+    for (auto& line : lines) {
+        line.dirty_beg = 0;
+        line.dirty_end = 0;
+    }
+}
+
+screen_stats const& terminal_screen::stats() const
+{
+    return m_stats;
+}
+
+void terminal_screen::add_scroll(int const top, int const bottom, int const count)
+{
+    if (m_scroll.count != 0 && (m_scroll.top != top || m_scroll.bottom != bottom)) {
+        mark_dirty(m_scroll.top, m_scroll.bottom);
+        m_scroll.count = 0;
+    }
+
+    // Once the whole region moved every line in it is new, the exact count
+    // doesn't matter anymore.
+    m_scroll.top = top;
+    m_scroll.bottom = bottom;
+    m_scroll.count = std::clamp(m_scroll.count + count, top - bottom, bottom - top);
+}
+
+line& terminal_screen::line_info(int const line)
+{
+    auto const physical = m_head + line;
+    return lines[physical < m_size.height ? physical : physical - m_size.height];
 }
 
-void terminal_screen::move_scroll(int change)
+line const& terminal_screen::line_info(int const line) const
 {
-    set_scroll(m_scroll + change);
+    auto const physical = m_head + line;
+    return lines[physical < m_size.height ? physical : physical - m_size.height];
 }
 
-void terminal_screen::set_scroll(int const scroll)
+void terminal_screen::rotate_lines(int const first, int const middle, int const last)
 {
+    reverse_lines(first, middle);
+    reverse_lines(middle, last);
+    reverse_lines(first, last);
+}
+
+void terminal_screen::reverse_lines(int first, int last)
+{
+    // Only the line structs are swapped, the glyphs stay where they are.
     auto const height = size().height;
-    auto const bounded = scroll % height;
-    if (bounded >= 0)
-        m_scroll = bounded;
-    else
-        m_scroll = height + bounded;
+    while (first + 1 < last) {
+        --last;
+        std::swap(line_info(first % height), line_info(last % height));
+        ++first;
+    }
 }
 
 } // katerm::
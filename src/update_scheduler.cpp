@@ -0,0 +1,49 @@
+#include <utility>
+
+#include <katerm/update_scheduler.hpp>
+
+namespace katerm {
+
+update_scheduler::update_scheduler(clock::duration const min_interval)
+    : m_min_interval{min_interval}
+{
+}
+
+void update_scheduler::on_frame_ready(std::function<void()> callback)
+{
+    m_frame_ready = std::move(callback);
+}
+
+void update_scheduler::set_min_interval(clock::duration const min_interval)
+{
+    m_min_interval = min_interval;
+}
+
+update_scheduler::clock::duration update_scheduler::min_interval() const
+{
+    return m_min_interval;
+}
+
+void update_scheduler::poll(terminal_screen const& screen, clock::time_point const now)
+{
+    m_pending = m_pending || screen.has_changes();
+    if (!m_pending || now < deadline())
+        return;
+
+    m_pending = false;
+    m_last_frame = now;
+
+    if (m_frame_ready)
+        m_frame_ready();
+}
+
+update_scheduler::clock::time_point update_scheduler::deadline() const
+{
+    if (!m_pending)
+        return clock::time_point::max();
+
+    // time_point::min() + interval doesn't overflow, unlike now - min().
+    return m_last_frame + m_min_interval;
+}
+
+} // katerm::
@@ -0,0 +1,30 @@
+#include <catch2/catch.hpp>
+
+#include <cw/character_width.hpp>
+
+TEST_CASE("Character width lookup table", "[width]") {
+    SECTION("Matches the range table search") {
+        auto mismatches = 0;
+        for (char32_t code = 0; code != 0x110100; ++code)
+            mismatches += cw::character_width(code) != cw::character_width_search(code);
+
+        REQUIRE(mismatches == 0);
+    }
+
+    SECTION("Known widths") {
+        REQUIRE(cw::character_width(U'a') == 1);
+        REQUIRE(cw::character_width(U'\n') == -1);
+        REQUIRE(cw::character_width(0x85) == -1);
+        REQUIRE(cw::character_width(U'é') == 1);
+        REQUIRE(cw::character_width(U'中') == 2);
+        REQUIRE(cw::character_width(0x1f600) == 2); // Grinning face
+        REQUIRE(cw::character_width(0x200d) == 0);  // Zero width joiner
+        REQUIRE(cw::character_width(0x20dd) == 0);  // Combining enclosing circle
+    }
+
+    SECTION("Non-spacing marks are zero width, spacing marks aren't") {
+        REQUIRE(cw::character_width(0x0301) == 0); // Combining acute accent, Mn
+        REQUIRE(cw::character_width(0x093f) == 1); // Devanagari vowel sign i, Mc
+        REQUIRE(cw::character_width(0x0903) == 1); // Devanagari sign visarga, Mc
+    }
+}
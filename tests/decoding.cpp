@@ -1,7 +1,12 @@
+#include <string>
+#include <algorithm>
+
 #include <catch2/catch.hpp>
 
+#include <katerm/colours.hpp>
 #include <katerm/terminal.hpp>
 #include <katerm/terminal_decoder.hpp>
+#include <katerm/printable_scan.hpp>
 
 TEST_CASE("utf-8", "[utf-8]") {
     auto decode_utf8 = [](auto const& utf8) {
@@ -32,3 +37,281 @@ TEST_CASE("utf-8", "[utf-8]") {
         REQUIRE(decode_utf8("⚡") == U'⚡');
     }
 }
+
+TEST_CASE("Printable ASCII scan", "[printable-scan]") {
+    char text[100];
+    for (auto& c : text)
+        c = 'a';
+
+    SECTION("Whole range is printable") {
+        REQUIRE(katerm::find_printable_end(text, text + 100) == text + 100);
+        REQUIRE(katerm::find_printable_end(text, text) == text);
+    }
+
+    SECTION("Stops at the first non printable byte") {
+        for (char const stop : {'\x1b', '\n', '\x7f', '\x80', '\xe2', '\x1f'}) {
+            for (int i = 0; i != 100; ++i) {
+                text[i] = stop;
+                REQUIRE(katerm::find_printable_end(text, text + 100) == text + i);
+                text[i] = 'a';
+            }
+        }
+    }
+
+    SECTION("Range boundaries are inclusive") {
+        text[40] = ' ';
+        text[41] = '~';
+        REQUIRE(katerm::find_printable_end(text, text + 100) == text + 100);
+    }
+}
+
+TEST_CASE("Printable runs", "[printable-runs]") {
+    auto t = katerm::terminal{{10, 4}};
+    auto d = katerm::decoder{};
+    auto instructee = katerm::terminal_instructee{&t};
+
+    SECTION("Runs are interrupted by control characters") {
+        char const text[] = "abc\r\nde\x1b[1mfg€h";
+        d.decode(text, sizeof(text) - 1, instructee);
+
+        REQUIRE(t.screen.get_glyph({2, 0}).code == 'c');
+        REQUIRE(t.screen.get_glyph({0, 1}).code == 'd');
+        REQUIRE(t.screen.get_glyph({1, 1}).code == 'e');
+        REQUIRE(t.screen.get_glyph({2, 1}).code == 'f');
+        REQUIRE(t.screen.get_glyph({2, 1}).style.mode.is_set(katerm::glyph_attr_bit::bold));
+        REQUIRE(t.screen.get_glyph({4, 1}).code == U'€');
+        REQUIRE(t.screen.get_glyph({5, 1}).code == 'h');
+        REQUIRE(t.cursor.pos == katerm::position{6, 1});
+    }
+
+    SECTION("Runs wrap around lines") {
+        char const text[] = "0123456789ABCDEFGHIJabc";
+        d.decode(text, sizeof(text) - 1, instructee);
+
+        REQUIRE(t.screen.get_glyph({9, 0}).code == '9');
+        REQUIRE(t.screen.get_glyph({0, 1}).code == 'A');
+        REQUIRE(t.screen.get_glyph({0, 2}).code == 'a');
+        REQUIRE(t.cursor.pos == katerm::position{3, 2});
+    }
+
+    SECTION("Runs continue after an incomplete sequence") {
+        char const part1[] = "ab\x1b[";
+        char const part2[] = "2Ccd";
+        d.decode(part1, sizeof(part1) - 1, instructee);
+        d.decode(part2, sizeof(part2) - 1, instructee);
+
+        REQUIRE(t.screen.get_glyph({1, 0}).code == 'b');
+        REQUIRE(t.screen.get_glyph({4, 0}).code == 'c');
+        REQUIRE(t.screen.get_glyph({5, 0}).code == 'd');
+    }
+}
+
+TEST_CASE("Chunked decoding", "[decode][chunks]") {
+    std::string const stream =
+        "plain text\r\n"
+        "\x1b[1;31mbold red\x1b[0m \x1b[38;2;10;20;30mrgb\x1b[m\r\n"
+        "€uro 한국어 🍆\r\n"
+        "\x1b]0;a window title that is longer than the inline pending buffer\a"
+        "after osc\x1b[2;5Hmoved\x1b[K\x1b(0qqq\x1b(B";
+
+    auto const decode_in_chunks = [&](std::size_t const chunk_size) {
+        auto t = katerm::terminal{{20, 6}};
+        auto d = katerm::decoder{};
+        auto instructee = katerm::terminal_instructee{&t};
+
+        for (std::size_t i = 0; i < stream.size(); i += chunk_size) {
+            auto const n = std::min(chunk_size, stream.size() - i);
+            d.decode(stream.data() + i, static_cast<int>(n), instructee);
+        }
+
+        return t;
+    };
+
+    auto const expected = decode_in_chunks(stream.size());
+    REQUIRE(expected.screen.get_glyph({0, 1}).code == 'b');
+    REQUIRE(expected.screen.get_glyph({4, 1}).code == 'm');
+
+    for (std::size_t chunk_size : {1, 2, 3, 5, 7, 13, 64, 65, 100}) {
+        auto const actual = decode_in_chunks(chunk_size);
+
+        INFO("chunk size " << chunk_size);
+        REQUIRE(actual.cursor.pos == expected.cursor.pos);
+        for (int y = 0; y != 6; ++y) {
+            for (int x = 0; x != 20; ++x) {
+                REQUIRE(actual.screen.get_glyph({x, y}).code
+                        == expected.screen.get_glyph({x, y}).code);
+            }
+        }
+    }
+}
+
+TEST_CASE("Overlong control strings", "[decode][osc]") {
+    auto t = katerm::terminal{{10, 4}};
+    auto d = katerm::decoder{};
+    auto instructee = katerm::terminal_instructee{&t};
+
+    d.set_max_string_length(16);
+
+    SECTION("Short strings are not counted") {
+        d.decode("\x1b]0;title\a", 10, instructee);
+        REQUIRE(d.overlong_string_count() == 0);
+    }
+
+    SECTION("Unterminated string is counted once") {
+        auto const payload = std::string(100, 'x');
+        d.decode("\x1b]0;", 4, instructee);
+        for (int i = 0; i != 10; ++i)
+            d.decode(payload.data(), static_cast<int>(payload.size()), instructee);
+
+        REQUIRE(d.overlong_string_count() == 1);
+        REQUIRE(t.screen.get_glyph({0, 0}).code == 0);
+
+        d.decode("\x1b\\ok", 4, instructee);
+        REQUIRE(d.overlong_string_count() == 1);
+        REQUIRE(t.screen.get_glyph({0, 0}).code == 'o');
+    }
+
+    SECTION("Terminated in the same call") {
+        auto const osc = "\x1bP" + std::string(40, 'x') + "\x1b\\";
+        d.decode(osc.data(), static_cast<int>(osc.size()), instructee);
+        d.decode(osc.data(), static_cast<int>(osc.size()), instructee);
+        REQUIRE(d.overlong_string_count() == 2);
+    }
+}
+
+TEST_CASE("Static dispatch", "[decode][static-dispatch]") {
+    char const text[] = "\x1b[2;3Hab\x1b[1mc\r\n€";
+
+    auto t1 = katerm::terminal{{10, 4}};
+    auto i1 = katerm::terminal_instructee{&t1};
+    katerm::decoder{}.decode(text, sizeof(text) - 1, i1);
+
+    auto t2 = katerm::terminal{{10, 4}};
+    auto i2 = katerm::terminal_instructee{&t2};
+    katerm::terminal_decoder{}.decode(text, sizeof(text) - 1, i2);
+
+    REQUIRE(t1.cursor.pos == t2.cursor.pos);
+    REQUIRE(t2.screen.get_glyph({2, 1}).code == 'a');
+    REQUIRE(t2.screen.get_glyph({4, 1}).style.mode.is_set(katerm::glyph_attr_bit::bold));
+    REQUIRE(t2.screen.get_glyph({0, 2}).code == U'€');
+}
+
+TEST_CASE("Stats", "[decode][stats]") {
+    auto t = katerm::terminal{{10, 4}};
+    auto d = katerm::terminal_decoder{};
+    auto instructee = katerm::terminal_instructee{&t};
+
+    // Without KATERM_STATS nothing is counted
+    auto const n = katerm::stats_enabled ? 1u : 0u;
+
+    char const text[] = "\x1b[1;31mab\x1b[m\x1b]0;title\a\x1b[4hc\x1b" "7\r\n\n\n\n\x1b[";
+    d.decode(text, sizeof(text) - 1, instructee);
+
+    auto const stats = d.stats();
+    REQUIRE(stats.bytes == n * (sizeof(text) - 1));
+    REQUIRE(stats.decode_calls == n);
+    REQUIRE(stats.split_sequences == n);
+    REQUIRE(stats.csi == n * 3);
+    REQUIRE(stats.csi_by_final['m' - 0x40] == n * 2);
+    REQUIRE(stats.csi_by_final['h' - 0x40] == n);
+    REQUIRE(stats.sgr_params == n * 2);
+    REQUIRE(stats.osc == n);
+    REQUIRE(stats.other_strings == 0);
+    REQUIRE(stats.string_bytes == n * 8);
+    REQUIRE(stats.escapes == n);
+
+    d.decode("4lx", 3, instructee);
+    REQUIRE(d.stats().decode_calls == n * 2);
+    REQUIRE(d.stats().split_sequences == n);
+
+    auto const term_stats = t.stats();
+    REQUIRE(term_stats.insert_mode_chars == n);
+    REQUIRE(term_stats.screen.scroll_ups == n);
+    REQUIRE(term_stats.screen.lines_scrolled == n);
+    REQUIRE((term_stats.screen.lines_dirtied != 0) == katerm::stats_enabled);
+}
+
+TEST_CASE("CSI parameters", "[decode][csi]") {
+    SECTION("Sub-parameters belong to the parameter before them") {
+        auto p = katerm::csi_params{};
+        p.push(1);
+        p.push(38);
+        p.push_sub(2);
+        p.push_sub(0);
+        p.push_sub(255);
+        p.push(0);
+
+        REQUIRE(p.size() == 3);
+        REQUIRE(p.get(0) == 1);
+        REQUIRE(p.get(1) == 38);
+        REQUIRE(p.get(2, 7) == 7);
+        REQUIRE(p.get(3, 7) == 7);
+        REQUIRE(p.sub_count(0) == 0);
+        REQUIRE(p.sub_count(1) == 3);
+        REQUIRE(p.get_sub(1, 0) == 2);
+        REQUIRE(p.get_sub(1, 1, 9) == 9);
+        REQUIRE(p.get_sub(1, 2) == 255);
+        REQUIRE(p.get_sub(1, 3, 9) == 9);
+    }
+
+    SECTION("Parameters that don't fit are dropped with their sub-parameters") {
+        auto p = katerm::csi_params{};
+        for (int i = 0; i != katerm::csi_params::max_params + 1; ++i)
+            p.push(i + 1);
+        p.push_sub(5);
+
+        REQUIRE(p.size() == katerm::csi_params::max_params);
+        REQUIRE(p.get(katerm::csi_params::max_params - 1) == katerm::csi_params::max_params);
+        REQUIRE(p.sub_count(katerm::csi_params::max_params - 1) == 0);
+    }
+
+    auto t = katerm::terminal{{10, 4}};
+    auto d = katerm::terminal_decoder{};
+    auto instructee = katerm::terminal_instructee{&t};
+
+    auto const fg = [&](int x) {
+        return katerm::to_u32(t.screen.get_glyph({x, 0}).style.fg);
+    };
+
+    auto const bg = [&](int x) {
+        return katerm::to_u32(t.screen.get_glyph({x, 0}).style.bg);
+    };
+
+    SECTION("Colon separated SGR colours") {
+        char const text[] =
+            "\x1b[38:2::10:20:30mA"
+            "\x1b[38:2:40:50:60;1mB"
+            "\x1b[0;48:5:196mC"
+            "\x1b[38:7:1;31mD";
+        d.decode(text, sizeof(text) - 1, instructee);
+
+        REQUIRE(fg(0) == katerm::to_u32({10, 20, 30}));
+        REQUIRE(fg(1) == katerm::to_u32({40, 50, 60}));
+        REQUIRE(t.screen.get_glyph({1, 0}).style.mode.is_set(katerm::glyph_attr_bit::bold));
+        REQUIRE(bg(2) == katerm::to_u32(katerm::eight_bit_lookup(196)));
+
+        // An unknown colour form only skips that parameter
+        REQUIRE(fg(3) == katerm::to_u32(katerm::sgr_colours[1]));
+    }
+
+    SECTION("Parameters split across decode calls") {
+        std::string const text = "\x1b[38;2;123;45;6mA\x1b[48:2:7:89:255mB";
+        for (std::size_t split = 0; split <= text.size(); ++split) {
+            t.screen.clear_line_from(0, 0, t.clear_glyph());
+            t.cursor.pos = {0, 0};
+            d.decode("\x1b[m", 3, instructee);
+
+            d.decode(text.data(), static_cast<int>(split), instructee);
+            d.decode(text.data() + split, static_cast<int>(text.size() - split), instructee);
+
+            REQUIRE(fg(0) == katerm::to_u32({123, 45, 6}));
+            REQUIRE(bg(1) == katerm::to_u32({7, 89, 255}));
+        }
+    }
+
+    SECTION("Large parameters are clamped") {
+        char const text[] = "\x1b[99999999999;3H";
+        d.decode(text, sizeof(text) - 1, instructee);
+        REQUIRE(t.cursor.pos == katerm::position{2, 3});
+    }
+}
@@ -0,0 +1,121 @@
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <katerm/frame.hpp>
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+
+namespace {
+
+std::string column(katerm::frame const& f)
+{
+    auto result = std::string{};
+    for (int y = 0; y != f.size().height; ++y) {
+        auto const code = f.get_glyph({0, y}).code;
+        result += code ? static_cast<char>(code) : '.';
+    }
+
+    return result;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Frame snapshots", "[frame]") {
+    katerm::terminal term{{5, 4}};
+    katerm::decoder decoder{};
+    katerm::terminal_instructee instructee{&term};
+
+    auto const write = [&](std::string const& text) {
+        decoder.decode(text.data(), static_cast<int>(text.size()), instructee);
+    };
+
+    write("a\r\nb\r\nc\r\nd");
+    auto const first = katerm::snapshot(term);
+    REQUIRE(column(first) == "abcd");
+    REQUIRE(first.cursor().pos == katerm::position{1, 3});
+    REQUIRE_FALSE(term.screen.line_changed(0));
+
+    SECTION("Frames don't change with the terminal") {
+        write("\x1b[1;1Hx");
+        REQUIRE(first.get_glyph({0, 0}).code == 'a');
+        REQUIRE(katerm::snapshot(term, first).get_glyph({0, 0}).code == 'x');
+    }
+
+    SECTION("Only changed lines differ") {
+        write("\x1b[2;3Hx");
+        auto const second = katerm::snapshot(term, first);
+        auto const d = katerm::diff(first, second);
+        REQUIRE(d.scroll == 0);
+        REQUIRE(d.lines == std::vector<int>{1});
+        REQUIRE(second.get_line(0) == first.get_line(0));
+    }
+
+    SECTION("Scrolling up") {
+        write("\r\ne\r\nf");
+        auto const second = katerm::snapshot(term, first);
+        REQUIRE(column(second) == "cdef");
+
+        auto const d = katerm::diff(first, second);
+        REQUIRE(d.scroll == 2);
+        REQUIRE(d.lines == std::vector<int>{2, 3});
+    }
+
+    SECTION("Scrolling down") {
+        write("\x1b[1;1H\x1bM");
+        auto const second = katerm::snapshot(term, first);
+        REQUIRE(column(second) == ".abc");
+
+        auto const d = katerm::diff(first, second);
+        REQUIRE(d.scroll == -1);
+        REQUIRE(d.lines == std::vector<int>{0});
+    }
+
+    SECTION("Frames in between can be skipped") {
+        write("\r\ne");
+        auto const second = katerm::snapshot(term, first);
+        write("\x1b[1;2Hx\x1b[4;1H\r\nf");
+        auto const third = katerm::snapshot(term, second);
+        REQUIRE(column(third) == "cdef");
+
+        auto const d = katerm::diff(first, third);
+        REQUIRE(d.scroll == 2);
+        REQUIRE(d.lines == std::vector<int>{2, 3});
+    }
+
+    SECTION("Scrolling a region") {
+        write("\x1b[1;3r\x1b[3;1H\ne");
+        auto const second = katerm::snapshot(term, first);
+        REQUIRE(column(second) == "bced");
+
+        auto const d = katerm::diff(first, second);
+        REQUIRE(d.scroll == 1);
+        REQUIRE(d.scroll_top == 0);
+        REQUIRE(d.scroll_bottom == 3);
+        REQUIRE(d.lines == std::vector<int>{2});
+        REQUIRE(second.get_line(3) == first.get_line(3));
+    }
+
+    SECTION("Skipped frames that scrolled another region") {
+        write("\r\ne");
+        auto const second = katerm::snapshot(term, first);
+        write("\x1b[1;3r\x1b[3;1H\n");
+        auto const third = katerm::snapshot(term, second);
+        REQUIRE(column(third) == "cd.e");
+
+        REQUIRE(katerm::diff(second, third).scroll == 1);
+
+        auto const d = katerm::diff(first, third);
+        REQUIRE(d.scroll == 0);
+        REQUIRE(d.lines == std::vector<int>{0, 1, 2, 3});
+    }
+
+    SECTION("Resizing changes every line") {
+        term.resize({5, 6});
+        auto const second = katerm::snapshot(term, first);
+        auto const d = katerm::diff(first, second);
+        REQUIRE(d.scroll == 0);
+        REQUIRE(d.lines.size() == 6);
+    }
+}
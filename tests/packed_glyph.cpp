@@ -0,0 +1,127 @@
+#include <cstring>
+
+#include <catch2/catch.hpp>
+
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+#include <katerm/compact_screen.hpp>
+
+TEST_CASE("Packed glyph round trip", "[packed-glyph]") {
+    katerm::colour_palette palette;
+
+    auto g = katerm::glyph{
+        katerm::glyph_style{{1, 2, 3}, {200, 100, 50}, katerm::glyph_attr_bit::bold},
+        U'🍆'};
+    g.style.mode.set(katerm::glyph_attr_bit::wide);
+
+    auto packed = katerm::packed_glyph{};
+    REQUIRE(katerm::packed_glyph::pack(g, palette, packed));
+    auto const unpacked = packed.unpack(palette);
+
+    REQUIRE(packed.code() == U'🍆');
+    REQUIRE(unpacked.code == U'🍆');
+    REQUIRE(unpacked.style.mode == g.style.mode);
+    REQUIRE(katerm::to_u32(unpacked.style.fg) == katerm::to_u32(g.style.fg));
+    REQUIRE(katerm::to_u32(unpacked.style.bg) == katerm::to_u32(g.style.bg));
+
+    SECTION("Colours are shared") {
+        auto again = katerm::packed_glyph{};
+        REQUIRE(katerm::packed_glyph::pack(g, palette, again));
+        REQUIRE(palette.size() == 2);
+        REQUIRE(again.unpack(palette).style.fg.b == 3);
+    }
+
+    SECTION("Released colours free their index") {
+        palette.retain(packed.fg_index());
+        palette.release(packed.fg_index());
+        REQUIRE(palette.size() == 2);
+
+        palette.release(packed.fg_index());
+        REQUIRE(palette.size() == 1);
+        REQUIRE(palette.intern({7, 8, 9}) == packed.fg_index());
+    }
+}
+
+TEST_CASE("Full palette", "[packed-glyph]") {
+    katerm::colour_palette palette;
+    for (std::size_t i = 0; i != katerm::colour_palette::max_colours; ++i) {
+        palette.intern({
+            static_cast<std::uint8_t>(i >> 8),
+            static_cast<std::uint8_t>(i),
+            0});
+    }
+
+    REQUIRE(palette.size() == katerm::colour_palette::max_colours);
+    REQUIRE(palette.intern({10, 20, 3}) == katerm::colour_palette::no_index);
+
+    // Colours that are in the palette are still found
+    auto const index = palette.intern({10, 20, 0});
+    REQUIRE(index != katerm::colour_palette::no_index);
+    REQUIRE(palette.get(index).g == 20);
+
+    auto packed = katerm::packed_glyph{};
+    auto const g = katerm::glyph{katerm::glyph_style{{10, 20, 0}, {1, 2, 3}, {}}, 'x'};
+    REQUIRE(!katerm::packed_glyph::pack(g, palette, packed));
+
+    // The fg reference taken before bg failed was given back
+    palette.release(index);
+    palette.release(index);
+    REQUIRE(palette.size() == katerm::colour_palette::max_colours - 1);
+    REQUIRE(palette.intern({10, 20, 3}) == index);
+}
+
+TEST_CASE("Compact screen", "[compact-screen]") {
+    katerm::terminal term{{10, 3}};
+    katerm::decoder decoder;
+    katerm::terminal_instructee instructee{&term};
+
+    auto const text = "ab\x1b[31mcd\r\n\x1b[7m€";
+    decoder.decode(text, static_cast<int>(std::strlen(text)), instructee);
+
+    auto const compact = katerm::compact_screen{term.screen};
+    REQUIRE(compact.size() == term.screen.size());
+    REQUIRE(compact.get_glyph({0, 0}).code == 'a');
+    REQUIRE(compact.get_glyph({2, 0}).style.fg.r == term.screen.get_glyph({2, 0}).style.fg.r);
+    REQUIRE(compact.get_glyph({0, 1}).code == U'€');
+    REQUIRE(compact.get_glyph({0, 1}).style.mode.is_set(katerm::glyph_attr_bit::reversed));
+
+    auto restored = katerm::terminal_screen{{10, 3}};
+    compact.copy_to(restored);
+    REQUIRE(restored.get_glyph({3, 0}).code == 'd');
+    REQUIRE(restored.get_glyph({0, 1}).code == U'€');
+}
+
+TEST_CASE("Compact screen keeps colours the palette can't hold", "[compact-screen]") {
+    auto const width = 300;
+    auto const height = 300;
+    auto compact = katerm::compact_screen{{width, height}};
+
+    // Every cell gets a colour of its own, more than a palette holds.
+    auto colour_of = [](int const i) {
+        return katerm::colour{
+            static_cast<std::uint8_t>(i >> 16),
+            static_cast<std::uint8_t>(i >> 8),
+            static_cast<std::uint8_t>(i)};
+    };
+
+    for (auto y = 0; y != height; ++y) {
+        for (auto x = 0; x != width; ++x) {
+            auto const i = y * width + x;
+            compact.set_glyph({x, y}, {{colour_of(i), colour_of(i), {}}, 'c'});
+        }
+    }
+
+    REQUIRE(katerm::to_u32(compact.get_glyph({width - 1, height - 1}).style.fg)
+            == katerm::to_u32(colour_of(width * height - 1)));
+
+    // Overwriting cells gives their colours back to the palette
+    for (auto y = 0; y != height; ++y) {
+        for (auto x = 0; x != width; ++x)
+            compact.set_glyph({x, y}, katerm::glyph{});
+    }
+
+    REQUIRE(compact.palette().size() == 1);
+    compact.set_glyph({0, 0}, {{{1, 36, 247}, {0, 0, 0}, {}}, 'd'});
+    REQUIRE(katerm::to_u32(compact.get_glyph({0, 0}).style.fg)
+            == katerm::to_u32(katerm::colour{1, 36, 247}));
+}
@@ -0,0 +1,77 @@
+#include <string>
+
+#include <catch2/catch.hpp>
+
+#include <katerm/pipeline.hpp>
+
+TEST_CASE("Byte ring", "[pipeline]") {
+    auto ring = katerm::byte_ring{5};
+    REQUIRE(ring.capacity() == 8);
+
+    auto const read_all = [&] {
+        auto result = std::string{};
+        char const* bytes;
+        while (auto const count = ring.peek(bytes)) {
+            result.append(bytes, count);
+            ring.consume(count);
+        }
+
+        return result;
+    };
+
+    SECTION("Full rings accept fewer bytes") {
+        REQUIRE(ring.write("0123456789", 10) == 8);
+        REQUIRE(ring.write("x", 1) == 0);
+        REQUIRE(read_all() == "01234567");
+    }
+
+    SECTION("Writes wrap around") {
+        ring.write("abcdef", 6);
+        read_all();
+
+        REQUIRE(ring.write("ghijkl", 6) == 6);
+
+        char const* bytes;
+        REQUIRE(ring.peek(bytes) == 2);
+        REQUIRE(read_all() == "ghijkl");
+    }
+}
+
+TEST_CASE("Frame mailbox", "[pipeline]") {
+    auto mailbox = katerm::frame_mailbox{};
+    auto term = katerm::terminal{{4, 2}};
+
+    REQUIRE_FALSE(mailbox.update());
+
+    term.write_char('a');
+    auto const first = katerm::snapshot(term);
+    mailbox.publish(first);
+
+    term.write_char('b');
+    mailbox.publish(katerm::snapshot(term, first));
+
+    // Only the newest frame is seen.
+    REQUIRE(mailbox.update());
+    REQUIRE(mailbox.current().get_glyph({1, 0}).code == 'b');
+    REQUIRE_FALSE(mailbox.update());
+    REQUIRE(mailbox.current().get_glyph({1, 0}).code == 'b');
+}
+
+TEST_CASE("Terminal pipeline", "[pipeline]") {
+    auto pipeline = katerm::terminal_pipeline{{10, 3}, 16};
+
+    SECTION("Fed bytes show up in the next frame") {
+        REQUIRE(pipeline.process() == 0);
+        REQUIRE_FALSE(pipeline.update());
+
+        pipeline.feed("ab\x1b[", 4);
+        REQUIRE(pipeline.process() == 4);
+        pipeline.feed("2;3Hc", 5);
+        REQUIRE(pipeline.process() == 5);
+
+        REQUIRE(pipeline.update());
+        auto const& f = pipeline.current();
+        REQUIRE(f.get_glyph({0, 0}).code == 'a');
+        REQUIRE(f.get_glyph({2, 1}).code == 'c');
+    }
+}
@@ -0,0 +1,42 @@
+#include <string>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+#include <katerm/pipeline.hpp>
+
+// Only built where there are threads, see CMakeLists.txt.
+
+TEST_CASE("Reader and decoder on their own threads", "[pipeline][threads]") {
+    auto pipeline = katerm::terminal_pipeline{{10, 3}, 16};
+
+    auto text = std::string{};
+    for (int i = 0; i != 1000; ++i)
+        text += "\r\n" + std::to_string(i);
+
+    auto reader = std::thread{[&] {
+        auto fed = std::size_t{};
+        while (fed != text.size()) {
+            if (auto const count = pipeline.feed(text.data() + fed, text.size() - fed))
+                fed += count;
+            else
+                std::this_thread::yield();
+        }
+    }};
+
+    auto decoded = std::size_t{};
+    while (decoded != text.size()) {
+        if (auto const count = pipeline.process())
+            decoded += count;
+        else
+            std::this_thread::yield();
+    }
+
+    reader.join();
+
+    REQUIRE(pipeline.update());
+    REQUIRE(pipeline.current().get_glyph({0, 2}).code == '9');
+    REQUIRE(pipeline.current().get_glyph({2, 2}).code == '9');
+    REQUIRE(pipeline.current().get_glyph({0, 1}).code == '9');
+    REQUIRE(pipeline.current().get_glyph({2, 1}).code == '8');
+}
@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <string>
+#include <algorithm>
 
 #include <catch2/catch.hpp>
 
@@ -53,3 +55,49 @@ TEST_CASE("Graphic0 out of bounds read", "[regression][write-char][graphic0]") {
     };
     run(grahpic0_write);
 }
+
+TEST_CASE("Long control string split across reads", "[regression][decode][osc]") {
+    // Control strings were parsed again from the start on every decode call
+    // until they were terminated, making them quadratic in their length.
+    katerm::decoder decoder;
+    katerm::terminal term{{80, 24}};
+    katerm::terminal_instructee instructee{&term};
+
+    auto const osc = std::string{"\x1b]0;"} + std::string(10 << 20, 'x') + "\a";
+    auto const chunk_size = std::size_t{4096};
+
+    for (std::size_t i = 0; i < osc.size(); i += chunk_size) {
+        auto const n = std::min(chunk_size, osc.size() - i);
+        decoder.decode(osc.data() + i, static_cast<int>(n), instructee);
+    }
+
+    REQUIRE(term.cursor.pos == katerm::position{0, 0});
+
+    decoder.decode("ok", 2, instructee);
+    REQUIRE(term.screen.get_glyph({0, 0}).code == 'o');
+    REQUIRE(term.screen.get_glyph({1, 0}).code == 'k');
+}
+
+TEST_CASE("Sequences split across reads", "[regression][decode]") {
+    katerm::decoder decoder;
+    katerm::terminal term{{80, 24}};
+    katerm::terminal_instructee instructee{&term};
+
+    SECTION("Parameter digits") {
+        for (char const c : std::string{"\x1b[12;345H"})
+            decoder.decode(&c, 1, instructee);
+
+        REQUIRE(term.cursor.pos == katerm::position{79, 11});
+    }
+
+    SECTION("Empty parameters default") {
+        decoder.decode("\x1b[;7H", 5, instructee);
+        REQUIRE(term.cursor.pos == katerm::position{6, 0});
+    }
+
+    SECTION("String aborted by escape sequence") {
+        decoder.decode("\x1bPabc", 5, instructee);
+        decoder.decode("\x1b[3Gx", 5, instructee);
+        REQUIRE(term.screen.get_glyph({2, 0}).code == 'x');
+    }
+}
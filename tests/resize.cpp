@@ -1,4 +1,5 @@
 #include <cstring>
+#include <string>
 
 #include <catch2/catch.hpp>
 
@@ -70,3 +71,176 @@ TEST_CASE("Size changes after resize", "[resize]") {
         REQUIRE(term.screen.size() == katerm::extend{4, 5});
     }
 }
+
+TEST_CASE("Resizing in place", "[resize]") {
+    katerm::terminal term{{12, 4}};
+    katerm::decoder decoder{};
+    katerm::terminal_instructee instructee{&term};
+
+    // Scroll once so the ring buffer doesn't start at the first line.
+    auto text = "one\r\ntwo\r\nthree\r\nfour\r\nfive";
+    decoder.decode(text, std::strlen(text), instructee);
+    term.screen.clear_changes();
+
+    auto const changed_lines = [&] {
+        auto count = 0;
+        for (int y = 0; y != term.screen.size().height; ++y)
+            count += term.screen.line_changed(y);
+        return count;
+    };
+
+    SECTION("Width changes keep lines clean") {
+        term.screen.resize({3, 4});
+        REQUIRE(changed_lines() == 0);
+        REQUIRE(term.screen.get_glyph({2, 1}).code == 'r');
+
+        term.screen.resize({20, 4});
+        REQUIRE(changed_lines() == 0);
+        REQUIRE(term.screen.get_glyph({0, 3}).code == 'f');
+        REQUIRE(term.screen.get_glyph({3, 1}).code == 0);
+
+        decoder.decode("\x1b[4;18Hx", 8, instructee);
+        REQUIRE(term.screen.get_glyph({17, 3}).code == 'x');
+        REQUIRE(term.screen.get_glyph({10, 3}).code == 0);
+    }
+
+    SECTION("The terminal resizes in place when nothing wraps") {
+        term.resize({20, 4});
+        REQUIRE(changed_lines() == 0);
+        REQUIRE(term.screen.history().size() == 1);
+
+        term.resize({5, 4});
+        REQUIRE(changed_lines() == 0);
+        REQUIRE(term.screen.get_glyph({4, 1}).code == 'e');
+
+        // Lines that don't fit are reflowed
+        term.resize({4, 4});
+        REQUIRE(changed_lines() == 4);
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 'e');
+        REQUIRE(term.screen.history().size() == 3);
+    }
+
+    SECTION("Growing marks only new lines") {
+        term.resize({12, 6});
+        REQUIRE(changed_lines() == 2);
+        REQUIRE(term.screen.line_changed(5));
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 't');
+        REQUIRE(term.screen.get_glyph({0, 3}).code == 'f');
+    }
+}
+
+namespace {
+
+std::string row_text(katerm::terminal const& term, int const y)
+{
+    auto text = std::string{};
+    for (int x = 0; x != term.screen.size().width; ++x) {
+        auto const code = term.screen.get_glyph({x, y}).code;
+        text += code ? static_cast<char>(code) : '.';
+    }
+
+    return text;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Wrapped lines are reflowed", "[resize][reflow]") {
+    katerm::terminal term{{10, 4}};
+    katerm::decoder decoder{};
+    katerm::terminal_instructee instructee{&term};
+
+    auto const write = [&](std::string const& text) {
+        decoder.decode(text.data(), static_cast<int>(text.size()), instructee);
+    };
+
+    SECTION("Narrowing and widening again") {
+        write("abcdefghijkl\r\nxy");
+        REQUIRE(row_text(term, 1) == "kl........");
+
+        term.resize({5, 4});
+        REQUIRE(row_text(term, 0) == "abcde");
+        REQUIRE(row_text(term, 1) == "fghij");
+        REQUIRE(row_text(term, 2) == "kl...");
+        REQUIRE(row_text(term, 3) == "xy...");
+        REQUIRE(term.cursor.pos == katerm::position{2, 3});
+
+        term.resize({20, 4});
+        REQUIRE(row_text(term, 0) == "abcdefghijkl........");
+        REQUIRE(row_text(term, 1) == "xy..................");
+        REQUIRE(term.cursor.pos == katerm::position{2, 1});
+
+        write("z");
+        REQUIRE(row_text(term, 1) == "xyz.................");
+    }
+
+    SECTION("The cursor stays with its glyph") {
+        write("0123456789abc\x1b[1;4H");
+        term.resize({4, 4});
+        REQUIRE(term.cursor.pos == katerm::position{3, 0});
+
+        write("\x1b[2;3H");
+        term.resize({6, 4});
+        REQUIRE(term.cursor.pos == katerm::position{0, 1});
+        REQUIRE(term.screen.get_glyph(term.cursor.pos).code == '6');
+    }
+
+    SECTION("Pending wraps continue after the glyph") {
+        write("0123456789");
+        term.resize({12, 4});
+        write("ab");
+        REQUIRE(row_text(term, 0) == "0123456789ab");
+    }
+
+    SECTION("Wide glyphs are not split") {
+        // U+4E2D is two columns wide.
+        write("a\xe4\xb8\xad" "b\xe4\xb8\xad");
+        term.resize({2, 5});
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 'a');
+        REQUIRE(term.screen.get_glyph({1, 0}).code == 0);
+        REQUIRE(term.screen.get_glyph({0, 1}).code == 0x4e2d);
+        REQUIRE(term.screen.get_glyph({1, 1}).style.mode.is_set(katerm::glyph_attr_bit::wdummy));
+        REQUIRE(term.screen.get_glyph({0, 2}).code == 'b');
+        REQUIRE(term.screen.get_glyph({0, 3}).code == 0x4e2d);
+
+        REQUIRE(term.cursor.pos == katerm::position{0, 4});
+
+        term.resize({10, 5});
+        REQUIRE(term.cursor.pos == katerm::position{6, 0});
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 'a');
+        REQUIRE(term.screen.get_glyph({1, 0}).code == 0x4e2d);
+        REQUIRE(term.screen.get_glyph({3, 0}).code == 'b');
+        REQUIRE(term.screen.get_glyph({4, 0}).code == 0x4e2d);
+        REQUIRE(term.screen.get_glyph({0, 1}).code == 0);
+    }
+
+    SECTION("Rows ending in a wide glyph stay wrapped") {
+        term.resize({4, 4});
+        write("\xe4\xb8\xad\xe4\xb8\xad\xe4\xb8\xad");
+        REQUIRE(term.screen.get_glyph({0, 1}).code == 0x4e2d);
+
+        term.resize({8, 4});
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 0x4e2d);
+        REQUIRE(term.screen.get_glyph({2, 0}).code == 0x4e2d);
+        REQUIRE(term.screen.get_glyph({4, 0}).code == 0x4e2d);
+        REQUIRE(term.screen.get_glyph({0, 1}).code == 0);
+        REQUIRE(term.cursor.pos == katerm::position{6, 0});
+
+        // Rows that end in a wdummy are wrapped by reflowing as well
+        term.resize({4, 4});
+        term.resize({8, 4});
+        REQUIRE(term.screen.get_glyph({4, 0}).code == 0x4e2d);
+        REQUIRE(term.cursor.pos == katerm::position{6, 0});
+    }
+
+    SECTION("Scrollback is reflowed too") {
+        write("aaaaaaaaaabbbbb\r\nccc\r\nddd\r\neee\r\nfff");
+        REQUIRE(term.screen.history().size() == 2);
+
+        term.resize({20, 4});
+        REQUIRE(term.screen.history().size() == 1);
+        REQUIRE(term.screen.history().line_length(0) == 15);
+        REQUIRE(row_text(term, 0) == "ccc.................");
+        REQUIRE(row_text(term, 3) == "fff.................");
+        REQUIRE(term.cursor.pos == katerm::position{3, 3});
+    }
+}
@@ -0,0 +1,223 @@
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <katerm/terminal.hpp>
+#include <katerm/terminal_decoder.hpp>
+#include <katerm/scrollback.hpp>
+
+namespace {
+
+std::vector<katerm::glyph> make_line(std::string const& text)
+{
+    auto line = std::vector<katerm::glyph>{};
+    for (auto const c : text)
+        line.push_back({katerm::default_style, static_cast<katerm::code_point>(c)});
+
+    return line;
+}
+
+std::string read_text(katerm::scrollback const& history, std::size_t const index)
+{
+    auto glyphs = std::vector<katerm::glyph>{};
+    history.read_line(index, glyphs);
+
+    auto text = std::string{};
+    for (auto const& g : glyphs)
+        text += g.code ? static_cast<char>(g.code) : ' ';
+
+    return text;
+}
+
+bool same_style(katerm::glyph_style const& a, katerm::glyph_style const& b)
+{
+    return a.mode == b.mode
+        && katerm::to_u32(a.fg) == katerm::to_u32(b.fg)
+        && katerm::to_u32(a.bg) == katerm::to_u32(b.bg);
+}
+
+} // anonymous namespace
+
+TEST_CASE("Scrollback storage", "[scrollback]") {
+    auto history = katerm::scrollback{};
+
+    SECTION("Lines are read back by index") {
+        for (auto const& text : {"first", "second", "third"}) {
+            auto const line = make_line(text);
+            history.push_line(line.data(), static_cast<int>(line.size()));
+        }
+
+        REQUIRE(history.size() == 3);
+        REQUIRE(read_text(history, 0) == "first");
+        REQUIRE(read_text(history, 2) == "third");
+        REQUIRE(history.line_length(1) == 6);
+        REQUIRE(history.get_glyph(1, 2).code == 'c');
+    }
+
+    SECTION("Oldest lines are dropped at the memory limit") {
+        history.set_max_bytes(3 * katerm::scrollback::chunk_glyphs * sizeof(katerm::packed_glyph));
+
+        auto text = std::string(1000, 'x');
+        for (std::size_t i = 0; i != text.size(); ++i)
+            text[i] = static_cast<char>('a' + i % 26);
+
+        auto const line = make_line(text);
+        for (int i = 0; i != 1000; ++i)
+            history.push_line(line.data(), static_cast<int>(line.size()));
+
+        REQUIRE(history.memory_usage() <= history.max_memory());
+        REQUIRE(history.size() < 1000);
+        REQUIRE(history.size() > 10);
+        REQUIRE(history.line_length(0) == 1000);
+    }
+
+    SECTION("Lines longer than a chunk") {
+        auto const line = make_line(std::string(katerm::scrollback::chunk_glyphs + 10, 'y'));
+        history.push_line(line.data(), static_cast<int>(line.size()));
+
+        auto const small = make_line("z");
+        history.push_line(small.data(), 1);
+
+        REQUIRE(history.line_length(0) == static_cast<int>(line.size()));
+        REQUIRE(read_text(history, 1) == "z");
+    }
+
+    SECTION("Old chunks are encoded and read back unchanged") {
+        auto lines = std::vector<std::vector<katerm::glyph>>{};
+        for (int i = 0; i != 1000; ++i) {
+            auto line = make_line("line " + std::to_string(i) + std::string(i % 7, 'z'));
+            line[0].style.fg = katerm::colour{static_cast<std::uint8_t>(i), 0, 0};
+            line[1].style.mode.set(katerm::glyph_attr_bit::bold);
+            line.resize(80, {katerm::default_style, 0});
+            line.back().style.bg = katerm::colour{0, 0, 255};
+            lines.push_back(line);
+        }
+
+        for (auto const& line : lines)
+            history.push_line(line.data(), static_cast<int>(line.size()));
+
+        auto const hot_bytes = lines.size() * 80 * sizeof(katerm::packed_glyph);
+        REQUIRE(history.memory_usage() < hot_bytes / 2);
+
+        for (std::size_t i = 0; i != lines.size(); ++i) {
+            auto read = std::vector<katerm::glyph>{};
+            history.read_line(i, read);
+            REQUIRE(read.size() == lines[i].size());
+
+            for (std::size_t x = 0; x != read.size(); ++x) {
+                REQUIRE(read[x].code == lines[i][x].code);
+                REQUIRE(same_style(read[x].style, lines[i][x].style));
+            }
+
+            REQUIRE(same_style(history.get_glyph(i, 79).style, lines[i][79].style));
+            REQUIRE(history.get_glyph(i, 0).code == 'l');
+        }
+    }
+
+    SECTION("Truecolour output keeps its colours and stays in the limit") {
+        auto colour_of = [](int const i) {
+            return katerm::colour{
+                static_cast<std::uint8_t>(i >> 16),
+                static_cast<std::uint8_t>(i >> 8),
+                static_cast<std::uint8_t>(i)};
+        };
+
+        // More colours than a palette holds, each line in a new one.
+        auto const count = 70000;
+        for (int i = 0; i != count; ++i) {
+            auto line = make_line("colour " + std::to_string(i));
+            for (auto& g : line)
+                g.style.fg = colour_of(i + 1);
+
+            history.push_line(line.data(), static_cast<int>(line.size()));
+        }
+
+        REQUIRE(history.memory_usage() <= history.max_memory());
+        REQUIRE(history.size() == count);
+
+        for (auto const i : {0, 9000, 65535, count - 1}) {
+            auto const fg = history.get_glyph(static_cast<std::size_t>(i), 0).style.fg;
+            REQUIRE(katerm::to_u32(fg) == katerm::to_u32(colour_of(i + 1)));
+        }
+
+        auto const wide = std::vector<katerm::glyph>(
+            katerm::scrollback::max_hot_line + 1,
+            {{katerm::colour{1, 36, 247}, katerm::colour{0, 0, 0}, {}}, 'w'});
+        history.push_line(wide.data(), static_cast<int>(wide.size()));
+
+        auto const last = history.size() - 1;
+        REQUIRE(history.line_length(last) == static_cast<int>(wide.size()));
+        REQUIRE(katerm::to_u32(history.get_glyph(last, 5).style.fg)
+                == katerm::to_u32(katerm::colour{1, 36, 247}));
+    }
+
+    SECTION("Log output shrinks tenfold once cold") {
+        auto const width = 200;
+        auto const count = 20000;
+
+        for (int i = 0; i != count; ++i) {
+            auto line = make_line("2024-01-01 12:00:00 INFO worker " + std::to_string(i)
+                                  + ": request handled in 12ms");
+            line.resize(width, {katerm::default_style, 0});
+            history.push_line(line.data(), width);
+        }
+
+        auto const hot_bytes = std::size_t{count} * width * sizeof(katerm::packed_glyph);
+        REQUIRE(history.size() == count);
+        REQUIRE(history.memory_usage() * 10 < hot_bytes);
+        REQUIRE(read_text(history, 0).substr(0, 24) == "2024-01-01 12:00:00 INFO");
+    }
+
+    SECTION("Disabled") {
+        history.set_max_bytes(0);
+        auto const line = make_line("abc");
+        history.push_line(line.data(), 3);
+        REQUIRE(history.size() == 0);
+    }
+}
+
+TEST_CASE("Scrolled off lines end up in the scrollback", "[scrollback][scroll]") {
+    katerm::terminal term{{5, 3}};
+    katerm::decoder decoder;
+    katerm::terminal_instructee instructee{&term};
+
+    auto const text = std::string{"one\r\ntwo\r\nthree\r\nfour\r\nfive"};
+    decoder.decode(text.data(), static_cast<int>(text.size()), instructee);
+
+    auto const& history = term.screen.history();
+    REQUIRE(history.size() == 2);
+    REQUIRE(read_text(history, 0) == "one");
+    REQUIRE(read_text(history, 1) == "two");
+    REQUIRE(term.screen.get_glyph({0, 0}).code == 't');
+
+    SECTION("Resizing keeps the scrollback") {
+        term.resize({8, 2});
+        REQUIRE(term.screen.history().size() == 3);
+        REQUIRE(read_text(term.screen.history(), 2) == "three");
+    }
+
+    SECTION("Deleting lines doesn't add to the scrollback") {
+        decoder.decode("\x1b[2;1H\x1b[M", 9, instructee);
+        REQUIRE(term.screen.history().size() == 2);
+
+        decoder.decode("\x1b[1;1H\x1b[M", 9, instructee);
+        REQUIRE(term.screen.history().size() == 2);
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 'f');
+    }
+
+    SECTION("Regions at the top of the screen scroll into the scrollback") {
+        // Rows 1 and 2, above a status line
+        decoder.decode("\x1b[1;2r\x1b[2;1H\n", 13, instructee);
+        REQUIRE(term.screen.history().size() == 3);
+        REQUIRE(read_text(term.screen.history(), 2) == "three");
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 'f');
+        REQUIRE(term.screen.get_glyph({1, 2}).code == 'i');
+    }
+
+    SECTION("Regions below the top of the screen don't") {
+        decoder.decode("\x1b[2;3r\x1b[3;1H\n", 13, instructee);
+        REQUIRE(term.screen.history().size() == 2);
+        REQUIRE(term.screen.get_glyph({0, 1}).code == 'f');
+    }
+}
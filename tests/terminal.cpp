@@ -1,4 +1,5 @@
 #include <utility>
+#include <string>
 #include <cstring>
 
 #include <catch2/catch.hpp>
@@ -250,3 +251,454 @@ TEST_CASE("Double wide", "[double-wide]") {
     REQUIRE(tst.t.screen.get_glyph({0, 0}).code == U'🍆');
     REQUIRE(tst.t.screen.get_glyph({1, 0}).code == 0);
 }
+
+TEST_CASE("Bulk writes match write_char", "[write][bulk]") {
+    auto const same_screen = [](katerm::terminal const& a, katerm::terminal const& b) {
+        REQUIRE(a.cursor.pos == b.cursor.pos);
+        REQUIRE(a.cursor.state == b.cursor.state);
+
+        for (int y = 0; y != a.screen.size().height; ++y) {
+            for (int x = 0; x != a.screen.size().width; ++x) {
+                auto const& ga = a.screen.get_glyph({x, y});
+                auto const& gb = b.screen.get_glyph({x, y});
+                REQUIRE(ga.code == gb.code);
+                REQUIRE(ga.style.mode == gb.style.mode);
+            }
+        }
+    };
+
+    auto bulk = katerm::terminal{{7, 4}};
+    auto single = katerm::terminal{{7, 4}};
+
+    SECTION("Code points") {
+        std::u32string const text = U"abc€defghij🍆klmnop한qrśtuvwxyz0123456789";
+
+        bulk.write_chars(
+            reinterpret_cast<katerm::code_point const*>(text.data()),
+            static_cast<int>(text.size()));
+
+        for (auto const ch : text)
+            single.write_char(ch);
+
+        same_screen(bulk, single);
+    }
+
+    SECTION("ASCII") {
+        std::string const text = "The quick brown fox jumps over the lazy dog";
+
+        bulk.write_ascii(text.data(), 10);
+        bulk.write_ascii(text.data() + 10, static_cast<int>(text.size()) - 10);
+
+        for (auto const ch : text)
+            single.write_char(static_cast<katerm::code_point>(ch));
+
+        same_screen(bulk, single);
+    }
+
+    SECTION("Insert mode") {
+        bulk.mode.set(katerm::terminal_mode_bit::insert);
+        single.mode.set(katerm::terminal_mode_bit::insert);
+
+        bulk.write_ascii("abc", 3);
+        bulk.move_cursor({1, 0});
+        bulk.write_ascii("XY", 2);
+
+        for (auto const ch : std::string{"abc"})
+            single.write_char(static_cast<katerm::code_point>(ch));
+        single.move_cursor({1, 0});
+        single.write_char('X');
+        single.write_char('Y');
+
+        same_screen(bulk, single);
+        REQUIRE(bulk.screen.get_glyph({3, 0}).code == 'b');
+    }
+}
+
+TEST_CASE("Screen scrolling", "[scroll][screen]") {
+    auto screen = katerm::terminal_screen{{3, 4}};
+    auto const fill = katerm::glyph{katerm::default_style, 0};
+
+    auto const label_lines = [&] {
+        for (int y = 0; y != 4; ++y)
+            screen.get_glyph({0, y}).code = 'a' + y;
+    };
+
+    auto const column = [&] {
+        auto result = std::string{};
+        for (int y = 0; y != 4; ++y) {
+            auto const code = screen.get_glyph({0, y}).code;
+            result += code ? static_cast<char>(code) : '.';
+        }
+        return result;
+    };
+
+    label_lines();
+
+    SECTION("Whole screen up") {
+        screen.scroll_up(0, 1, fill);
+        REQUIRE(column() == "bcd.");
+        screen.scroll_up(0, 2, fill);
+        REQUIRE(column() == "d...");
+    }
+
+    SECTION("Whole screen down") {
+        screen.scroll_down(0, 1, fill);
+        REQUIRE(column() == ".abc");
+    }
+
+    SECTION("Many scrolls wrap around the ring") {
+        for (int i = 0; i != 10; ++i) {
+            screen.scroll_up(0, 1, fill);
+            screen.get_glyph({0, 3}).code = 'A' + i;
+        }
+
+        REQUIRE(column() == "GHIJ");
+    }
+
+    SECTION("Partial scrolls after whole screen scrolls") {
+        screen.scroll_up(0, 1, fill);
+        label_lines();
+
+        screen.scroll_up(1, 1, fill);
+        REQUIRE(column() == "acd.");
+
+        screen.scroll_down(2, 1, fill);
+        REQUIRE(column() == "ac.d");
+    }
+
+    SECTION("Regions only move their own lines") {
+        screen.clear_changes();
+        screen.scroll_up(1, 3, 1, fill);
+        REQUIRE(column() == "ac.d");
+        REQUIRE_FALSE(screen.line_changed(0));
+        REQUIRE_FALSE(screen.line_changed(3));
+        REQUIRE(screen.history().size() == 0);
+
+        screen.scroll_down(0, 3, 1, fill);
+        REQUIRE(column() == ".acd");
+    }
+
+    SECTION("Large regions move the ring and put the other lines back") {
+        screen.scroll_up(0, 1, fill);
+        label_lines();
+        screen.clear_changes();
+
+        screen.scroll_up(0, 3, 1, fill);
+        REQUIRE(column() == "bc.d");
+        REQUIRE_FALSE(screen.line_changed(3));
+
+        screen.clear_changes();
+        screen.scroll_down(1, 4, 1, fill);
+        REQUIRE(column() == "b.c.");
+        REQUIRE_FALSE(screen.line_changed(0));
+
+        // The region starts at the top, so its first line went to the
+        // history too.
+        REQUIRE(screen.history().size() == 2);
+    }
+
+    SECTION("The scroll of one region is reported") {
+        screen.clear_changes();
+        screen.scroll_up(1, 3, 1, fill);
+        screen.scroll_up(1, 3, 1, fill);
+        auto change = screen.changed_scroll();
+        REQUIRE(change.top == 1);
+        REQUIRE(change.bottom == 3);
+        REQUIRE(change.count == 2);
+        REQUIRE_FALSE(screen.line_changed(0));
+
+        // A second region makes the lines of the first one dirty
+        screen.scroll_down(0, 2, 1, fill);
+        change = screen.changed_scroll();
+        REQUIRE(change.top == 0);
+        REQUIRE(change.bottom == 2);
+        REQUIRE(change.count == -1);
+        REQUIRE(screen.line_changed(2));
+        REQUIRE_FALSE(screen.line_changed(3));
+    }
+
+    SECTION("Copies are independent") {
+        screen.scroll_up(0, 1, fill);
+        auto copy = screen;
+        copy.get_glyph({0, 0}).code = 'x';
+        REQUIRE(screen.get_glyph({0, 0}).code == 'b');
+    }
+}
+
+TEST_CASE("Scroll regions", "[scroll][region]") {
+    auto tst = test_term({5, 5});
+
+    auto const write = [&](std::string const& text) {
+        tst.process_bytes(text.data(), text.size());
+    };
+
+    auto const column = [&] {
+        auto result = std::string{};
+        for (int y = 0; y != 5; ++y) {
+            auto const code = tst.t.screen.get_glyph({0, y}).code;
+            result += code ? static_cast<char>(code) : '.';
+        }
+        return result;
+    };
+
+    write("a\r\nb\r\nc\r\nd\r\ne");
+
+    SECTION("Setting the region homes the cursor") {
+        write("\x1b[2;4r");
+        REQUIRE(tst.t.scroll_region_top() == 1);
+        REQUIRE(tst.t.scroll_region_bottom() == 4);
+        REQUIRE(tst.t.cursor.pos == katerm::position{0, 0});
+    }
+
+    SECTION("Line feeds at the bottom margin scroll the region") {
+        write("\x1b[2;4r\x1b[4;1H\nx");
+        REQUIRE(column() == "acdxe");
+        REQUIRE(tst.t.screen.history().size() == 0);
+    }
+
+    SECTION("Reverse line feeds at the top margin scroll the region") {
+        write("\x1b[2;4r\x1b[2;1H\x1bMx");
+        REQUIRE(column() == "axbce");
+    }
+
+    SECTION("Below the region the cursor stops at the last line") {
+        write("\x1b[1;3r\x1b[5;1H\n\nx");
+        REQUIRE(column() == "abcdx");
+    }
+
+    SECTION("Inserting and deleting lines stays in the region") {
+        write("\x1b[2;4r\x1b[2;1H\x1b[L");
+        REQUIRE(column() == "a.bce");
+        write("\x1b[M\x1b[M");
+        REQUIRE(column() == "ac..e");
+
+        // Outside the region nothing happens
+        write("\x1b[5;1H\x1b[L");
+        REQUIRE(column() == "ac..e");
+    }
+
+    SECTION("Several lines of a large region") {
+        auto& screen = tst.t.screen;
+        screen.scroll_up(0, 4, 2, tst.t.clear_glyph());
+        REQUIRE(column() == "cd..e");
+
+        screen.scroll_down(1, 5, 2, tst.t.clear_glyph());
+        REQUIRE(column() == "c..d.");
+    }
+
+    SECTION("Invalid regions are ignored") {
+        write("\x1b[2;4r\x1b[3;3r");
+        REQUIRE(tst.t.scroll_region_top() == 1);
+        REQUIRE(tst.t.scroll_region_bottom() == 4);
+    }
+
+    SECTION("No parameters and resizing reset the region") {
+        write("\x1b[2;4r\x1b[r");
+        REQUIRE(tst.t.scroll_region_top() == 0);
+        REQUIRE(tst.t.scroll_region_bottom() == 5);
+
+        write("\x1b[2;4r");
+        tst.t.resize({5, 6});
+        REQUIRE(tst.t.scroll_region_bottom() == 6);
+    }
+}
+
+TEST_CASE("Only the used part of lines is stored", "[screen]") {
+    auto tst = test_term({10, 3});
+    auto const& screen = tst.t.screen;
+
+    auto const write = [&](std::string const& text) {
+        tst.process_bytes(text.data(), text.size());
+    };
+
+    write("abc");
+    REQUIRE(screen.line_length(0) == 3);
+    REQUIRE(screen.line_length(1) == 0);
+
+    SECTION("Clearing the screen forgets the glyphs") {
+        write("\x1b[44m\x1b[2J");
+        REQUIRE(screen.line_length(0) == 0);
+        REQUIRE(screen.get_glyph({1, 0}).code == 0);
+        REQUIRE(screen.get_glyph({1, 0}).style.bg.b == screen.line_fill(0).style.bg.b);
+        REQUIRE(screen.get_glyph({9, 2}).style.bg.b == screen.line_fill(2).style.bg.b);
+    }
+
+    SECTION("Clearing to the end keeps the start") {
+        write("\x1b[2G\x1b[K");
+        REQUIRE(screen.line_length(0) == 1);
+        REQUIRE(screen.get_glyph({0, 0}).code == 'a');
+        REQUIRE(screen.get_glyph({1, 0}).code == 0);
+    }
+
+    SECTION("Writing past the used part fills the gap") {
+        write("\x1b[41m\x1b[K\x1b[8Gx");
+        REQUIRE(screen.line_length(0) == 8);
+        REQUIRE(screen.get_glyph({0, 0}).code == 'a');
+        REQUIRE(screen.get_glyph({5, 0}).style.bg.r == screen.line_fill(0).style.bg.r);
+        REQUIRE(screen.get_glyph({7, 0}).code == 'x');
+    }
+
+    SECTION("Resizing copies the used part") {
+        tst.t.screen.resize({2, 3});
+        REQUIRE(screen.line_length(0) == 2);
+        REQUIRE(screen.get_glyph({1, 0}).code == 'b');
+
+        tst.t.screen.resize({10, 3});
+        REQUIRE(screen.line_length(0) == 2);
+        REQUIRE(screen.get_glyph({2, 0}).code == 0);
+    }
+}
+
+TEST_CASE("Damage is tracked per column", "[screen][damage]") {
+    auto tst = test_term({20, 4});
+    auto const& screen = tst.t.screen;
+
+    auto const write = [&](std::string const& text) {
+        tst.process_bytes(text.data(), text.size());
+    };
+
+    write("abcdefgh\r\nabcdefgh");
+    tst.t.screen.clear_changes();
+    REQUIRE(screen.damage().empty());
+
+    SECTION("Writing a character") {
+        write("\x1b[1;6Hx");
+        REQUIRE(screen.line_damage(0) == katerm::rect{5, 6, 0, 1});
+        REQUIRE_FALSE(screen.line_changed(1));
+    }
+
+    SECTION("Spans grow to cover every change") {
+        write("\x1b[1;3Hx\x1b[1;10Hyz");
+        REQUIRE(screen.line_damage(0) == katerm::rect{2, 11, 0, 1});
+    }
+
+    SECTION("Equal spans on consecutive lines are merged") {
+        write("\x1b[1;4Hx\x1b[2;4Hx\x1b[4;4Hx");
+        auto const damage = screen.damage();
+        REQUIRE(damage.size() == 2);
+        REQUIRE(damage[0] == katerm::rect{3, 4, 0, 2});
+        REQUIRE(damage[1] == katerm::rect{3, 4, 3, 4});
+    }
+
+    SECTION("Deleting and inserting damage up to the end of the line") {
+        write("\x1b[1;3H\x1b[2P");
+        REQUIRE(screen.line_damage(0) == katerm::rect{2, 20, 0, 1});
+
+        write("\x1b[2;5H\x1b[@");
+        REQUIRE(screen.line_damage(1) == katerm::rect{4, 20, 1, 2});
+    }
+
+    SECTION("Clearing part of a line") {
+        write("\x1b[1;3H\x1b[1K");
+        REQUIRE(screen.line_damage(0) == katerm::rect{0, 3, 0, 1});
+    }
+
+    SECTION("Whole lines") {
+        write("\x1b[2J");
+        REQUIRE(screen.damage() == std::vector<katerm::rect>{{0, 20, 0, 4}});
+    }
+}
+
+TEST_CASE("Grapheme clusters", "[write][cluster]") {
+    auto tst = test_term({10, 3});
+    auto& term = tst.t;
+
+    auto const cluster_at = [&](katerm::position const pos) {
+        auto const& gl = term.screen.get_glyph(pos);
+        REQUIRE(gl.style.mode.is_set(katerm::glyph_attr_bit::cluster));
+
+        auto const cluster = term.screen.clusters().get(gl.code);
+        return std::u32string(cluster.code_points, cluster.code_points + cluster.count);
+    };
+
+    SECTION("Combining marks join the previous glyph") {
+        term.write_char('e');
+        term.write_char(0x301);
+        term.write_char('x');
+
+        REQUIRE(cluster_at({0, 0}) == U"é");
+        REQUIRE(term.screen.get_glyph({1, 0}).code == 'x');
+        REQUIRE(term.cursor.pos == katerm::position{2, 0});
+    }
+
+    SECTION("Single code points don't use the table") {
+        term.write_char('a');
+        REQUIRE_FALSE(term.screen.get_glyph({0, 0}).style.mode.is_set(katerm::glyph_attr_bit::cluster));
+        REQUIRE(term.screen.clusters().size() == 0);
+    }
+
+    SECTION("Control characters don't join a cluster") {
+        tst.process_bytes("a\0b\x7f\x01", 5);
+        REQUIRE_FALSE(term.screen.get_glyph({0, 0}).style.mode.is_set(katerm::glyph_attr_bit::cluster));
+        REQUIRE(term.screen.get_glyph({1, 0}).code == 'b');
+        REQUIRE(term.screen.get_glyph({2, 0}).code == 0);
+        REQUIRE(term.screen.clusters().size() == 0);
+        REQUIRE(term.cursor.pos == katerm::position{2, 0});
+    }
+
+    SECTION("Marks at the start of a line are dropped") {
+        term.write_char(0x301);
+        REQUIRE(term.screen.get_glyph({0, 0}).code == 0);
+        REQUIRE(term.cursor.pos == katerm::position{0, 0});
+    }
+
+    SECTION("Wide glyphs and the last column") {
+        term.move_cursor({7, 0});
+        term.write_char(0x4e2d);
+        term.write_char(0x20dd);
+        REQUIRE(cluster_at({7, 0}) == U"\u4e2d\u20dd");
+
+        term.write_char('z');
+        term.write_char(0x308);
+        REQUIRE(cluster_at({9, 0}) == U"z\u0308");
+        REQUIRE(term.cursor.pos == katerm::position{9, 0});
+    }
+
+    SECTION("Zero width joiner sequences take one cell") {
+        // Woman, zero width joiner, laptop
+        auto const sequence = std::u32string{U"\U0001f469\u200d\U0001f4bb"};
+        for (auto const ch : sequence)
+            term.write_char(ch);
+
+        REQUIRE(cluster_at({0, 0}) == sequence);
+        REQUIRE(term.cursor.pos == katerm::position{2, 0});
+    }
+
+    SECTION("Equal clusters are stored once") {
+        for (int i = 0; i != 5; ++i) {
+            term.write_char('e');
+            term.write_char(0x301);
+        }
+
+        REQUIRE(term.screen.clusters().size() == 1);
+        REQUIRE(term.screen.get_glyph({0, 0}).code == term.screen.get_glyph({4, 0}).code);
+    }
+
+    SECTION("Shared tables are only copied for new clusters") {
+        term.write_char('e');
+        term.write_char(0x301);
+
+        // Like a published frame holding on to the table
+        auto const shared = term.screen.shared_clusters();
+        term.write_char('e');
+        term.write_char(0x301);
+        REQUIRE(term.screen.shared_clusters() == shared);
+
+        term.write_char('a');
+        term.write_char(0x308);
+        REQUIRE(term.screen.shared_clusters() != shared);
+        REQUIRE(shared->size() == 1);
+    }
+
+    SECTION("Copies don't see each other's clusters") {
+        term.write_char('e');
+        term.write_char(0x301);
+
+        auto copy = term;
+        copy.write_char('a');
+        copy.write_char(0x308);
+
+        REQUIRE(copy.screen.clusters().size() == 2);
+        REQUIRE(term.screen.clusters().size() == 1);
+    }
+}
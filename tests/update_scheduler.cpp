@@ -0,0 +1,63 @@
+#include <chrono>
+
+#include <catch2/catch.hpp>
+
+#include <katerm/terminal.hpp>
+#include <katerm/update_scheduler.hpp>
+
+TEST_CASE("Update scheduler", "[scheduler]") {
+    using namespace std::chrono_literals;
+    using clock = katerm::update_scheduler::clock;
+
+    auto term = katerm::terminal{{10, 4}};
+    auto scheduler = katerm::update_scheduler{10ms};
+    auto frames = 0;
+
+    scheduler.on_frame_ready([&] {
+        ++frames;
+        term.screen.clear_changes();
+    });
+
+    term.screen.clear_changes();
+    auto const start = clock::now();
+
+    SECTION("Nothing to draw") {
+        scheduler.poll(term.screen, start);
+        REQUIRE(frames == 0);
+        REQUIRE(scheduler.deadline() == clock::time_point::max());
+    }
+
+    SECTION("Changes after a quiet period are reported right away") {
+        term.write_char('a');
+        scheduler.poll(term.screen, start);
+        REQUIRE(frames == 1);
+
+        term.write_char('b');
+        scheduler.poll(term.screen, start + 20ms);
+        REQUIRE(frames == 2);
+    }
+
+    SECTION("Fast changes are coalesced") {
+        term.write_char('a');
+        scheduler.poll(term.screen, start);
+
+        for (auto t = 1ms; t != 10ms; ++t) {
+            term.write_char('b');
+            scheduler.poll(term.screen, start + t);
+        }
+
+        REQUIRE(frames == 1);
+        REQUIRE(scheduler.deadline() == start + 10ms);
+
+        // Held changes are flushed once due, even without new output.
+        scheduler.poll(term.screen, start + 10ms);
+        REQUIRE(frames == 2);
+        REQUIRE(scheduler.deadline() == clock::time_point::max());
+    }
+
+    SECTION("Scrolling counts as a change") {
+        term.scroll_up();
+        scheduler.poll(term.screen, start);
+        REQUIRE(frames == 1);
+    }
+}